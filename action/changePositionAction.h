@@ -14,17 +14,22 @@ public:
 
     virtual ~ChangePositionAction(){}
 
+    virtual std::string GetConfigKey()
+    {
+        return "ChangePositionAction:" + std::to_string((int)destination_);
+    }
+
 private:
     virtual void OnInitialize()
     {
-        start_time = std::chrono::steady_clock::now();
+        start_time = blackboard_ptr_->now;
         blackboard_ptr_->setDestination(destination_);
     }
 
     virtual BehaviorState Update()
     {
         if (std::chrono::duration_cast<std::chrono::milliseconds>(
-            (std::chrono::steady_clock::now()-start_time)
+            (blackboard_ptr_->now-start_time)
             ) >= std::chrono::milliseconds(500))
         {
             blackboard_ptr_->setPosition(destination_);
@@ -38,6 +43,17 @@ private:
         
     }
 
+    // 热替换时沿用旧节点的开始时间，动作按原计划完成
+    virtual bool AdoptState(const BehaviorNode::Ptr &old_node_ptr)
+    {
+        auto old_action_ptr = std::dynamic_pointer_cast<ChangePositionAction>(old_node_ptr);
+        if (!old_action_ptr || old_action_ptr->destination_ != destination_) {
+            return false;
+        }
+        start_time = old_action_ptr->start_time;
+        return true;
+    }
+
     Position destination_;
     std::chrono::steady_clock::time_point start_time;
 };
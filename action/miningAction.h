@@ -13,16 +13,21 @@ public:
 
     virtual ~MinningAction(){}
 
+    virtual std::string GetConfigKey()
+    {
+        return "MinningAction";
+    }
+
 private:
     virtual void OnInitialize()
     {
-        start_time = std::chrono::steady_clock::now();
+        start_time = blackboard_ptr_->now;
     }
 
     virtual BehaviorState Update()
     {
         if (std::chrono::duration_cast<std::chrono::milliseconds>(
-            (std::chrono::steady_clock::now()-start_time)
+            (blackboard_ptr_->now-start_time)
             ) >= std::chrono::milliseconds(500))
         {
             blackboard_ptr_->adjustEnergy(-40);
@@ -36,6 +41,16 @@ private:
         
     }
 
+    virtual bool AdoptState(const BehaviorNode::Ptr &old_node_ptr)
+    {
+        auto old_action_ptr = std::dynamic_pointer_cast<MinningAction>(old_node_ptr);
+        if (!old_action_ptr) {
+            return false;
+        }
+        start_time = old_action_ptr->start_time;
+        return true;
+    }
+
     std::chrono::steady_clock::time_point start_time;
 };
 
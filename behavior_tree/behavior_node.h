@@ -8,6 +8,8 @@
 #include<functional>
 #include<blackboard.h>
 #include<algorithm>
+#include<chrono>
+#include<cstdint>
 
 // 为了enum转string
 #define FOREACH_BEHAVIORSTATE(FUNC) \
@@ -22,6 +24,12 @@
         FUNC(SEQUENCE) \
         FUNC(ACTION) \
         FUNC(PRECONDITION) \
+        FUNC(FOREACH) \
+        FUNC(COOLDOWN) \
+        FUNC(THROTTLE) \
+        FUNC(TIMEOUT) \
+        FUNC(RETRY) \
+        FUNC(SUBTREE) \
 
 #define TO_ENUM(x) x,
 #define TO_STRING(x) #x,
@@ -56,6 +64,82 @@ enum class AbortType {
 };
 
 
+/**
+ * @brief 单次遍历的时间预算
+ * @details 在当前线程上生效，作用域结束时恢复上一层预算。
+ * 预算耗尽后，选择、序列、并行节点会在两次子节点Run之间（安全点）停下并返回RUNNING，
+ * 由于停下的位置记录在children_node_index_中，下一次遍历会从该处继续执行。
+ * 每个组合节点在一次Update中至少运行一个子节点，保证预算再小也能向前推进。
+ */
+class TickBudget
+{
+  public:
+    TickBudget(std::chrono::microseconds budget) :
+      deadline_(std::chrono::steady_clock::now() + budget),
+      yielded_(false),
+      previous_(Current())
+    {
+      Current() = this;
+    }
+
+    ~TickBudget()
+    {
+      Current() = previous_;
+    }
+
+    // 本次遍历是否在安全点被中断
+    bool Yielded()
+    {
+      return yielded_;
+    }
+
+    // 在安全点调用，预算耗尽时返回true，并使上层节点也在各自的安全点停下
+    static bool ShouldYield()
+    {
+      TickBudget *budget = Current();
+      if (budget == nullptr) {
+        return false;
+      }
+      if (!budget->yielded_ && std::chrono::steady_clock::now() >= budget->deadline_) {
+        budget->yielded_ = true;
+      }
+      return budget->yielded_;
+    }
+
+  private:
+    static TickBudget *&Current()
+    {
+      static thread_local TickBudget *current = nullptr;
+      return current;
+    }
+
+    std::chrono::steady_clock::time_point deadline_;
+    bool yielded_;
+    TickBudget *previous_;
+};
+
+
+class BehaviorNode;
+
+/**
+ * @brief 节点状态变化的监听者，用于向外部调试器发布状态变化（见StatePublisher）
+ * @details 只有状态实际改变时才会通知，RUNNING的节点被Reset时abort为true。
+ * 使用ForEachNode并行运行子树时会在多个线程上被调用，实现需要自行加锁。
+ */
+class StateListener
+{
+  public:
+    virtual ~StateListener(){}
+
+    virtual void OnTransition(uint32_t node_id, BehaviorState state, bool abort) = 0;
+    // 节点在运行中创建了子树（SubtreeNode、ForEachNode），需要为子树中的节点分配编号
+    virtual void OnSubtreeAttached(const std::shared_ptr<BehaviorNode> &parent_node_ptr,
+                                   const std::shared_ptr<BehaviorNode> &subtree_node_ptr) = 0;
+    // 子树即将被释放
+    virtual void OnSubtreeDetached(const std::shared_ptr<BehaviorNode> &subtree_node_ptr) = 0;
+};
+
+
 /**
  * enable_shared_from_this是一个模板类，用于在类成员函数里创建一个指向当前类对象的share_ptr
  * 例如DecoratorNode中的setChild方法就需要为子节点设置父节点（即对象本身）
@@ -74,8 +158,9 @@ class BehaviorNode : public std::enable_shared_from_this<BehaviorNode>
       name_(name),
       behavior_state_(BehaviorState::IDLE),
       behavior_type_(behavior_type),
-      parent_node_ptr_(nullptr),
-      blackboard_ptr_(blackboard_ptr){}
+      blackboard_ptr_(blackboard_ptr),
+      state_listener_(nullptr),
+      node_id_(0){}
 
     virtual ~BehaviorNode(){}
 
@@ -93,7 +178,11 @@ class BehaviorNode : public std::enable_shared_from_this<BehaviorNode>
 
       // Update中又会调用子节点的Run,因此状态的返回、节点的终止都是由内而外
       NodeInfo("MethodInto:Update");
+      BehaviorState previous_state = behavior_state_;
       behavior_state_ = Update();
+      if (state_listener_ != nullptr && behavior_state_ != previous_state) {
+        state_listener_->OnTransition(node_id_, behavior_state_, false);
+      }
       NodeInfo("MethodOut:Update");
 
       if (behavior_state_ != BehaviorState::RUNNING)
@@ -114,7 +203,7 @@ class BehaviorNode : public std::enable_shared_from_this<BehaviorNode>
     
     BehaviorNode::Ptr GetParent()
     {
-      return parent_node_ptr_;
+      return parent_node_ptr_.lock();
     }
     // 派生节点一定会有父节点，但是不是所有的节点都是需要有子节点的，
     // 因此基类中定义了parent_node_ptr_，而没有定义child_node_ptr_
@@ -122,11 +211,26 @@ class BehaviorNode : public std::enable_shared_from_this<BehaviorNode>
       return nullptr;
     }
 
+    // 运行中按需创建的子树（如ForEachNode各元素的子树），需要遍历整棵树的地方（如StatePublisher）据此找到它们
+    virtual void GetDynamicChildren(std::vector<std::shared_ptr<BehaviorNode>> &){}
+
     BehaviorType GetBehaviorType()
     {
       return behavior_type_;
     }
 
+    std::string GetName()
+    {
+      return name_;
+    }
+
+    // 叶子节点的配置标识，标识相同的叶子节点行为完全一致，可以被优化器合并（见TreeOptimizer）
+    // 返回空字符串表示不可合并
+    virtual std::string GetConfigKey()
+    {
+      return "";
+    }
+
     BehaviorState GetBehaviorState(){
       return behavior_state_;
     }
@@ -138,15 +242,85 @@ class BehaviorNode : public std::enable_shared_from_this<BehaviorNode>
       NodeInfo("MethodInto:Reset");
       if (behavior_state_ == BehaviorState::RUNNING){
         behavior_state_ = BehaviorState::IDLE;
+        if (state_listener_ != nullptr) {
+          state_listener_->OnTransition(node_id_, behavior_state_, true);
+        }
         NodeInfo("MethodInto:OnTerminate");
         OnTerminate(BehaviorState::IDLE);
         NodeInfo("MethodOut:OnTerminate");
       }
       NodeInfo("MethodOut:Reset");
     }
+
+    // 热替换时（见BehaviorTree::Swap）从旧树中同名、同类型且正在运行的节点接管运行状态，
+    // 接管成功后本节点以RUNNING状态继续，下一次Run不再调用OnInitialize
+    bool AdoptRunning(const BehaviorNode::Ptr &old_node_ptr)
+    {
+      if (old_node_ptr->GetBehaviorState() != BehaviorState::RUNNING
+          || old_node_ptr->GetName() != name_ || old_node_ptr->GetBehaviorType() != behavior_type_
+          || !AdoptState(old_node_ptr)) {
+        return false;
+      }
+      behavior_state_ = BehaviorState::RUNNING;
+      return true;
+    }
+
+    // 运行状态已被新树中的节点接管，直接置为IDLE而不调用OnTerminate
+    void ReleaseState()
+    {
+      behavior_state_ = BehaviorState::IDLE;
+    }
+
+    // 由StatePublisher在遍历树时设置，nullptr表示不发布
+    void SetStateListener(StateListener *state_listener, uint32_t node_id)
+    {
+      state_listener_ = state_listener;
+      node_id_ = node_id;
+    }
+
+    StateListener *GetStateListener()
+    {
+      return state_listener_;
+    }
+
+    uint32_t GetNodeId()
+    {
+      return node_id_;
+    }
+
+    // 关闭后NodeInfo不再输出，用于大规模运行（如harness/stress_harness.cpp），应在遍历开始前设置
+    static void SetLogEnabled(bool log_enabled)
+    {
+      LogEnabled() = log_enabled;
+    }
   protected:
-    void NodeInfo(std::string msg)
+    // 复制旧节点的内部状态，旧节点的实际类型不同或状态无法对应时返回false，本节点将重新初始化
+    // 默认不接管，带有内部状态的派生类需要重写
+    virtual bool AdoptState(const BehaviorNode::Ptr &)
+    {
+      return false;
+    }
+
+    // 只复位正在运行的节点，终止、复位的代价只与正在运行的节点数相关，而与子树大小无关
+    static void ResetRunning(const BehaviorNode::Ptr &node_ptr)
+    {
+      if (node_ptr->GetBehaviorState() == BehaviorState::RUNNING) {
+        node_ptr->Reset();
+      }
+    }
+
+    static bool &LogEnabled()
+    {
+      static bool log_enabled = true;
+      return log_enabled;
+    }
+
+    // 参数用const char*，关闭输出时不会为较长的字面量构造std::string
+    void NodeInfo(const char *msg)
     {
+      if (!LogEnabled()) {
+        return;
+      }
       static std::string behavior_types[] = {FOREACH_BEHAVIORTYPE(TO_STRING)};
       static std::string behavior_states[] = {FOREACH_BEHAVIORSTATE(TO_STRING)};
 
@@ -165,8 +339,11 @@ class BehaviorNode : public std::enable_shared_from_this<BehaviorNode>
     std::string name_;
     BehaviorState behavior_state_;
     BehaviorType behavior_type_;
-    BehaviorNode::Ptr parent_node_ptr_;
+    // 父节点持有子节点，子节点只弱引用父节点，避免循环引用导致整棵树无法释放
+    std::weak_ptr<BehaviorNode> parent_node_ptr_;
     BlackBoard::Ptr blackboard_ptr_;
+    StateListener *state_listener_;
+    uint32_t node_id_;
 
 };
 
@@ -203,6 +380,11 @@ class DecoratorNode : public BehaviorNode
       child_node_ptr->SetParent(shared_from_this());
     }
 
+    virtual BehaviorNode::Ptr GetChild()
+    {
+      return child_node_ptr_;
+    }
+
     virtual ~DecoratorNode(){}
 
   protected:
@@ -229,6 +411,12 @@ class PreconditionNode : public DecoratorNode
       return abort_type_;
     }
 
+    // 仅评估准入条件本身，不运行子节点，也不触发任何终止逻辑
+    bool CheckPrecondition()
+    {
+      return Precondition();
+    }
+
   protected:
     virtual bool Precondition()
     {
@@ -256,12 +444,12 @@ class PreconditionNode : public DecoratorNode
     virtual void OnTerminate(BehaviorState state) {
       switch (state){
         case BehaviorState::IDLE:
-          child_node_ptr_->Reset();
+          ResetRunning(child_node_ptr_);
           break;
         case BehaviorState::SUCCESS:
           break;
         case BehaviorState::FAILURE:
-          child_node_ptr_->Reset();
+          ResetRunning(child_node_ptr_);
           break;
         default:
           return;
@@ -270,6 +458,12 @@ class PreconditionNode : public DecoratorNode
 
     virtual bool Reevaluation();
 
+    // 准入条件每次遍历都重新评估，没有需要接管的状态
+    virtual bool AdoptState(const BehaviorNode::Ptr &old_node_ptr)
+    {
+      return std::dynamic_pointer_cast<PreconditionNode>(old_node_ptr) != nullptr;
+    }
+
     // std::function实现了函数指针的功能，这里表示函数返回类型是bool，且函数无参数、
     // 我们可以传入lambda函数，利用捕获列表捕获外部变量，这样就使得参数列表为空
     // 注意，类普通土成员函数不能直接传入，因为它默认带有this参数
@@ -304,15 +498,68 @@ class CompositeNode : public BehaviorNode
       return children_node_ptr_;
     }
 
+    // 替换第index个子节点，用于在首次遍历前调整树结构
+    virtual void ReplaceChild(unsigned int index, const BehaviorNode::Ptr &children_node_ptr)
+    {
+      children_node_ptr_.at(index) = children_node_ptr;
+      children_node_ptr->SetParent(shared_from_this());
+    }
+
+    virtual void ClearChildren()
+    {
+      children_node_ptr_.clear();
+      children_node_index_ = 0;
+    }
+
     unsigned int GetChildrenIndex()
     {
       return children_node_index_;
     }
 
+    // 查找子节点的位置，找不到时返回-1
+    // 默认线性查找，子节点很多的派生类可以重写为索引查找
+    virtual int GetChildIndex(const BehaviorNode::Ptr &children_node_ptr)
+    {
+      auto iter = std::find(children_node_ptr_.begin(), children_node_ptr_.end(), children_node_ptr);
+      if (iter == children_node_ptr_.end()) {
+        return -1;
+      }
+      return iter - children_node_ptr_.begin();
+    }
+
   protected:
     virtual void OnInitialize() = 0;
     virtual BehaviorState Update() = 0;
     virtual void OnTerminate(BehaviorState state) = 0;    
+
+    // 按名字找到旧节点正在或待运行的子节点在本节点中的位置，新树中删除了该子节点时不接管
+    // 序列节点中位于其左侧的子节点视为已经完成
+    virtual bool AdoptState(const BehaviorNode::Ptr &old_node_ptr)
+    {
+      auto old_composite_node_ptr = std::dynamic_pointer_cast<CompositeNode>(old_node_ptr);
+      if (!old_composite_node_ptr
+          || old_composite_node_ptr->children_node_index_ >= old_composite_node_ptr->children_node_ptr_.size()) {
+        return false;
+      }
+      int index = FindChildByName(
+        old_composite_node_ptr->children_node_ptr_.at(old_composite_node_ptr->children_node_index_)->GetName());
+      if (index < 0) {
+        return false;
+      }
+      children_node_index_ = index;
+      return true;
+    }
+
+    int FindChildByName(const std::string &name)
+    {
+      for (unsigned int index = 0; index < children_node_ptr_.size(); index++) {
+        if (children_node_ptr_.at(index)->GetName() == name) {
+          return index;
+        }
+      }
+      return -1;
+    }
+
     std::vector<BehaviorNode::Ptr> children_node_ptr_;
     // 记录当前正在或待运行运行的节点编号
     unsigned int children_node_index_;
@@ -330,11 +577,27 @@ class SelectorNode : public CompositeNode
     virtual void AddChildren(const BehaviorNode::Ptr &children_node_ptr)
     {
       CompositeNode::AddChildren(children_node_ptr);
-      children_node_reevaluation_.push_back(
-        children_node_ptr->GetBehaviorType()==BehaviorType::PRECONDITION 
+      children_node_reevaluation_.push_back(NeedReevaluation(children_node_ptr));
+    }
+
+    virtual void ReplaceChild(unsigned int index, const BehaviorNode::Ptr &children_node_ptr)
+    {
+      CompositeNode::ReplaceChild(index, children_node_ptr);
+      children_node_reevaluation_.at(index) = NeedReevaluation(children_node_ptr);
+    }
+
+    virtual void ClearChildren()
+    {
+      CompositeNode::ClearChildren();
+      children_node_reevaluation_.clear();
+    }
+
+    // 终止类型为LOW_PRIORITY和BOTH的条件子节点需要在每次遍历时重新评估
+    static bool NeedReevaluation(const BehaviorNode::Ptr &children_node_ptr)
+    {
+      return children_node_ptr->GetBehaviorType()==BehaviorType::PRECONDITION
         && (std::dynamic_pointer_cast<PreconditionNode>(children_node_ptr)->GetAbortType()==AbortType::LOW_PRIORITY
-        || std::dynamic_pointer_cast<PreconditionNode>(children_node_ptr)->GetAbortType()==AbortType::BOTH)
-      );
+        || std::dynamic_pointer_cast<PreconditionNode>(children_node_ptr)->GetAbortType()==AbortType::BOTH);
     }
 
     void SetChildrenIndex(unsigned int children_node_index)
@@ -395,13 +658,19 @@ class SelectorNode : public CompositeNode
           children_node_index_ = 0;
           return BehaviorState::FAILURE;
         }
+
+        // 预算耗尽，下一次遍历从children_node_index_继续
+        if (TickBudget::ShouldYield())
+        {
+          return BehaviorState::RUNNING;
+        }
       }
     }
     // 复位当前运行或待运行的子节点
     virtual void OnTerminate(BehaviorState state){
       switch (state){
         case BehaviorState::IDLE:
-          children_node_ptr_.at(children_node_index_)->Reset();
+          ResetRunning(children_node_ptr_.at(children_node_index_));
           break;
         case BehaviorState::SUCCESS:
           break;
@@ -455,13 +724,19 @@ class SequenceNode : public CompositeNode
           children_node_index_ = 0;
           return BehaviorState::SUCCESS;
         }
+
+        // 预算耗尽，下一次遍历从children_node_index_继续
+        if (TickBudget::ShouldYield())
+        {
+          return BehaviorState::RUNNING;
+        }
       }
     }    
 
     virtual void OnTerminate(BehaviorState state){
       switch (state){
         case BehaviorState::IDLE:
-          children_node_ptr_.at(children_node_index_)->Reset();
+          ResetRunning(children_node_ptr_.at(children_node_index_));
           break;
         case BehaviorState::SUCCESS:
           break;
@@ -483,14 +758,23 @@ class ParallelNode : public CompositeNode
 
     virtual ~ParallelNode(){}
 
+    unsigned int GetThreshold()
+    {
+      return threshold_;
+    }
+
   protected:
     virtual void OnInitialize()
     {
       success_count_ = 0;
       failure_count_ = 0;
+      children_node_index_ = 0;
       children_node_done_.clear();
       // 节点默认标记为false，表未曾访问
       children_node_done_.resize(children_node_ptr_.size(), false);
+      children_node_running_.clear();
+      children_node_running_.resize(children_node_ptr_.size(), false);
+      running_children_.clear();
     }
 
     virtual BehaviorState Update()
@@ -499,13 +783,28 @@ class ParallelNode : public CompositeNode
         return BehaviorState::SUCCESS;
       }
 
-      for (unsigned int index=0; index<children_node_ptr_.size(); index++)
+      // 上一次遍历因预算耗尽中断时，从中断处继续
+      bool children_node_run = false;
+      for (unsigned int index=children_node_index_; index<children_node_ptr_.size(); index++)
       {
         // 仅运行未曾执行完毕的节点
         if (children_node_done_.at(index)==false)
         {
+          // 预算耗尽，下一次遍历从该子节点继续
+          if (children_node_run && TickBudget::ShouldYield())
+          {
+            children_node_index_ = index;
+            return BehaviorState::RUNNING;
+          }
           // 运行子节点
           BehaviorState state = children_node_ptr_.at(index)->Run();
+          children_node_run = true;
+
+          if (state == BehaviorState::RUNNING && !children_node_running_.at(index))
+          {
+            children_node_running_.at(index) = true;
+            running_children_.push_back(index);
+          }
 
           if (state == BehaviorState::SUCCESS)
           {
@@ -531,7 +830,8 @@ class ParallelNode : public CompositeNode
       }
 
       // 有多个节点还处于RUNNING状态，等待下一次行为树遍历继续执行
-        return BehaviorState::RUNNING;
+      children_node_index_ = 0;
+      return BehaviorState::RUNNING;
     }
 
     virtual void OnTerminate(BehaviorState state){
@@ -545,11 +845,50 @@ class ParallelNode : public CompositeNode
         default:
           return;
       }
-      for (unsigned int index = 0; index<children_node_ptr_.size(); index++) {
-        children_node_ptr_.at(index)->Reset();
+      // 只复位启动过且尚未完成的子节点
+      for (auto index : running_children_) {
+        children_node_running_.at(index) = false;
+        ResetRunning(children_node_ptr_.at(index));
       }
+      running_children_.clear();
   }
 
+    // 按名字对应新旧子节点：已完成的子节点保留其结果，运行中的子节点仍登记为需要复位，
+    // 新增的子节点在下一次遍历时启动
+    virtual bool AdoptState(const BehaviorNode::Ptr &old_node_ptr)
+    {
+      auto old_parallel_node_ptr = std::dynamic_pointer_cast<ParallelNode>(old_node_ptr);
+      if (!old_parallel_node_ptr) {
+        return false;
+      }
+      OnInitialize();
+      for (unsigned int old_index = 0; old_index < old_parallel_node_ptr->children_node_ptr_.size(); old_index++)
+      {
+        BehaviorNode::Ptr old_children_node_ptr = old_parallel_node_ptr->children_node_ptr_.at(old_index);
+        int index = FindChildByName(old_children_node_ptr->GetName());
+        if (index < 0) {
+          continue;
+        }
+        if (old_parallel_node_ptr->children_node_done_.at(old_index))
+        {
+          children_node_done_.at(index) = true;
+          if (old_children_node_ptr->GetBehaviorState() == BehaviorState::SUCCESS) {
+            success_count_++;
+          } else {
+            failure_count_++;
+          }
+        }
+        else if (old_parallel_node_ptr->children_node_running_.at(old_index))
+        {
+          children_node_running_.at(index) = true;
+          running_children_.push_back(index);
+        }
+      }
+      // 阈值或子节点变化后已经可以结束时（判定同Update），重新开始
+      return success_count_ < threshold_
+        && (failure_count_ == 0 || failure_count_ < children_node_ptr_.size() - threshold_);
+    }
+
     // 终止并行节点所需的SUCCESS节点数
     unsigned int threshold_;
     unsigned int success_count_;
@@ -559,34 +898,36 @@ class ParallelNode : public CompositeNode
     // 所谓的并行，就是在一帧内启动所有节点，可以想像，在这一帧内大多的节点都
     // 会返回RUNNING状态，在后续的几帧中，会有陆续节点转换到SUCCESS或FALURE
     std::vector<bool> children_node_done_;
+    // 返回过RUNNING的子节点，终止时只需复位这些节点
+    std::vector<bool> children_node_running_;
+    std::vector<unsigned int> running_children_;
 };
 
 
 // 重新评估选择节点，查看左侧高优先级节点的条件是否满足
 bool PreconditionNode::Reevaluation()
 {
-  if (parent_node_ptr_ != nullptr && parent_node_ptr_->GetBehaviorType() == BehaviorType::SELECTOR
+  BehaviorNode::Ptr parent_node_ptr = parent_node_ptr_.lock();
+  if (parent_node_ptr != nullptr && parent_node_ptr->GetBehaviorType() == BehaviorType::SELECTOR
       && (abort_type_ == AbortType::LOW_PRIORITY || abort_type_ ==  AbortType::BOTH))
   {
     //BehaviorNode 没有GetChildren等派生类的方法，因此不能用多态指针
-    auto parent_selector_node_ptr = std::dynamic_pointer_cast<SelectorNode>(parent_node_ptr_);
-    auto parent_children = parent_selector_node_ptr->GetChildren();
-    auto iter_in_parent = std::find(parent_children.begin(), parent_children.end(), shared_from_this());
+    auto parent_selector_node_ptr = std::dynamic_pointer_cast<SelectorNode>(parent_node_ptr);
+    // 计算当前选择节点在父节点子节点中的位置
+    int index_in_parent = parent_selector_node_ptr->GetChildIndex(shared_from_this());
     // 意外，没找到
-    if (iter_in_parent == parent_children.end()) {
+    if (index_in_parent < 0) {
       std::cerr << "Can't find current node in parent!" << std::endl;
       return false;
     }
-    // 计算当前选择节点在parent_children中的位置
-    unsigned int index_in_parent = iter_in_parent - parent_children.begin();
     // 当前节点优先级高于运行节点（在运行节点左侧）,不包含当前前提节点是正在运行节点的情况
-    if (index_in_parent < parent_selector_node_ptr->GetChildrenIndex())
+    if ((unsigned int)index_in_parent < parent_selector_node_ptr->GetChildrenIndex())
     {
       // 符合准入条件，则将待运行节点设置为当前节点
       if(Precondition())
       {
         // 终止掉低优先级节点
-        parent_children.at(parent_selector_node_ptr->GetChildrenIndex())->Reset();
+        ResetRunning(parent_selector_node_ptr->GetChildren().at(parent_selector_node_ptr->GetChildrenIndex()));
         parent_selector_node_ptr->SetChildrenIndex(index_in_parent);
         // 还没有终止子节点
         return true;
@@ -10,16 +10,96 @@
 #define BEHAVIOR_TREE_H
 
 #include<behavior_node.h>
+#include<subtree_node.h>
+#include<shm_segment.h>
+#include<state_stream.h>
+#include<tree_optimizer.h>
+#include<atomic>
 #include<chrono>
+#include<mutex>
 #include<thread>
+#include<unordered_set>
+
+// 最近一次热替换（见BehaviorTree::Swap）的处理结果
+enum class SwapStatus
+{
+    NONE,       ///<没有调用过Swap
+    PENDING,    ///<已通过校验，等待下一次遍历前替换
+    APPLIED,    ///<已替换
+    REJECTED    ///<校验失败或与旧树共用节点，旧树保持不变
+};
 
 class BehaviorTree
 {
 public:
+    typedef std::shared_ptr<BehaviorTree> Ptr;
+
     BehaviorTree(const BehaviorNode::Ptr &root_node, int cycle_duration, const BlackBoard::Ptr &blackboard):
         root_node_(root_node),
         blackboard_(blackboard),
-        cycle_duration_(cycle_duration){}
+        cycle_duration_(cycle_duration),
+        tick_budget_(0),
+        preempted_(false),
+        swap_pending_(false),
+        swap_status_(SwapStatus::NONE){}
+
+    // 节点可能比行为树活得更久，不能留下指向发布者的指针
+    ~BehaviorTree()
+    {
+        if (state_publisher_) {
+            state_publisher_->Detach();
+        }
+    }
+
+    // 遍历一次行为树，遍历前更新黑板上的时钟与遍历计数
+    BehaviorState Tick()
+    {
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        blackboard_->tick_delta = std::chrono::duration_cast<std::chrono::milliseconds>(now - blackboard_->now);
+        blackboard_->now = now;
+        blackboard_->tick++;
+        preempted_ = false;
+        // 只在两次遍历之间替换，遍历过程中看到的始终是一棵完整的树
+        if (swap_pending_.load()) {
+            ApplySwap();
+        }
+        if (shm_binding_) {
+            shm_binding_->Pull(*blackboard_);
+        }
+        blackboard_->pollScopes();
+        BehaviorState state = root_node_->Run();
+        if (shm_binding_) {
+            shm_binding_->Push(*blackboard_);
+        }
+        if (subtree_evictor_) {
+            subtree_evictor_->Sweep(now);
+        }
+        if (state_publisher_) {
+            state_publisher_->Flush(blackboard_->tick);
+        }
+        return state;
+    }
+
+    // 限时遍历：预算耗尽时在安全点停下，下一次遍历从停下的位置继续，见TickBudget
+    BehaviorState Tick(std::chrono::microseconds budget)
+    {
+        TickBudget tick_budget(budget);
+        BehaviorState state = Tick();
+        preempted_ = tick_budget.Yielded();
+        return state;
+    }
+
+    // 上一次遍历是否因预算耗尽而中断
+    bool Preempted()
+    {
+        return preempted_;
+    }
+
+    // 设置Run中每帧的遍历预算，0表示不限时
+    void SetTickBudget(std::chrono::microseconds tick_budget)
+    {
+        tick_budget_ = tick_budget;
+    }
 
     void Run()
     {
@@ -29,12 +109,19 @@ public:
             std::cout << "---------------frame "+std::to_string(blackboard_->frame)
                         +"---------------" << std::endl;
             std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
-            root_node_->Run();
+            if (tick_budget_ > std::chrono::microseconds(0)) {
+                Tick(tick_budget_);
+            } else {
+                Tick();
+            }
             std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
             std::chrono::milliseconds execution_duration =
                 std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
             std::chrono::milliseconds sleep_time = cycle_duration_ - execution_duration;
             blackboard_->Info();
+            if (preempted_) {
+                std::cout << "tree preempted, resume next frame!" << std::endl;
+            }
             if (sleep_time > std::chrono::milliseconds(0)) {
                 std::cout << "tree sleeping!" << std::endl << std::endl;
                 std::this_thread::sleep_for(sleep_time);
@@ -46,10 +133,204 @@ public:
             blackboard_->frame++;
         }
     }
+
+    /**
+     * @brief 热替换行为树，可以在任意线程调用
+     * @details 新树在调用线程上校验，校验通过后在下一次遍历开始前替换。
+     * 运行状态自根节点向下接管：根节点与旧根节点同名、同类型时接管其运行状态（见BehaviorNode::AdoptRunning），
+     * 接管成功的节点，其子节点按名字（与所在位置无关）对应旧节点的子节点并继续接管。
+     * 旧树中没有被接管的运行中节点由下向上依次Reset。多次调用时以最后一次为准。
+     * 新树必须由新创建的节点组成，与旧树共用节点时在替换前被拒绝
+     * @return 新树校验失败时返回false，旧树保持不变；返回true只表示等待替换，替换结果见GetSwapStatus
+     */
+    bool Swap(const BehaviorNode::Ptr &root_node)
+    {
+        TreeOptimizer optimizer;
+        std::vector<std::string> errors;
+        if (!optimizer.Validate(root_node, errors))
+        {
+            for (auto &error : errors) {
+                std::cerr << "swap tree invalid: " << error << std::endl;
+            }
+            swap_status_.store(SwapStatus::REJECTED);
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(swap_mutex_);
+        pending_root_node_ = root_node;
+        swap_pending_.store(true);
+        swap_status_.store(SwapStatus::PENDING);
+        return true;
+    }
+
+    // 最近一次Swap的处理结果，可以在任意线程调用
+    SwapStatus GetSwapStatus()
+    {
+        return swap_status_.load();
+    }
+
+    BehaviorNode::Ptr GetRoot()
+    {
+        return root_node_;
+    }
+
+    // 设置后每次遍历结束时释放空闲超时的子树实例，见SubtreeNode
+    void SetSubtreeEvictor(const SubtreeEvictor::Ptr &subtree_evictor)
+    {
+        subtree_evictor_ = subtree_evictor;
+    }
+
+    // 设置后每次遍历前从共享内存读取外部进程的输入，遍历后写回决策结果，见ShmBinding
+    void SetShmBinding(const ShmBinding::Ptr &shm_binding)
+    {
+        shm_binding_ = shm_binding;
+    }
+
+    // 设置后每次遍历结束时发布本帧的节点状态变化，见StatePublisher
+    void SetStatePublisher(const StatePublisher::Ptr &state_publisher)
+    {
+        if (state_publisher_) {
+            state_publisher_->Detach();
+        }
+        state_publisher_ = state_publisher;
+        if (state_publisher_) {
+            state_publisher_->Attach(root_node_);
+        }
+    }
+
+    BlackBoard::Ptr GetBlackBoard()
+    {
+        return blackboard_;
+    }
+
 private:
+    void ApplySwap()
+    {
+        BehaviorNode::Ptr root_node;
+        {
+            std::lock_guard<std::mutex> lock(swap_mutex_);
+            root_node.swap(pending_root_node_);
+            swap_pending_.store(false);
+        }
+
+        std::unordered_set<BehaviorNode*> old_nodes;
+        CollectNodes(root_node_, old_nodes);
+        if (Shares(root_node, old_nodes))
+        {
+            std::cerr << "swap tree shares nodes with the running tree!" << std::endl;
+            SetSwapStatus(SwapStatus::REJECTED);
+            return;
+        }
+
+        // 先让被接管的旧节点静默退出，剩下仍在运行的旧节点才需要Reset
+        std::vector<BehaviorNode::Ptr> adopted_nodes;
+        Adopt(root_node_, root_node, adopted_nodes);
+        for (auto &node_ptr : adopted_nodes) {
+            node_ptr->ReleaseState();
+        }
+        ResetRunningNodes(root_node_);
+        // 旧树的节点释放前重新分配编号
+        if (state_publisher_) {
+            state_publisher_->Attach(root_node);
+        }
+        root_node_ = root_node;
+        SetSwapStatus(SwapStatus::APPLIED);
+    }
+
+    // 处理期间又有新的Swap时，状态保持为PENDING
+    void SetSwapStatus(SwapStatus swap_status)
+    {
+        std::lock_guard<std::mutex> lock(swap_mutex_);
+        if (!swap_pending_.load()) {
+            swap_status_.store(swap_status);
+        }
+    }
+
+    // 自上而下接管，父节点接管成功后其子节点才按名字与旧节点的子节点对应
+    static void Adopt(const BehaviorNode::Ptr &old_node_ptr, const BehaviorNode::Ptr &node_ptr,
+                      std::vector<BehaviorNode::Ptr> &adopted_nodes)
+    {
+        if (!node_ptr->AdoptRunning(old_node_ptr)) {
+            return;
+        }
+        adopted_nodes.push_back(old_node_ptr);
+
+        // SubtreeNode接管的子树实例已不在旧节点下，原样保留
+        std::vector<BehaviorNode::Ptr> old_children, children;
+        GetChildren(old_node_ptr, old_children);
+        GetChildren(node_ptr, children);
+        for (auto &children_node_ptr : children)
+        {
+            for (auto &old_children_node_ptr : old_children)
+            {
+                if (old_children_node_ptr->GetName() == children_node_ptr->GetName()) {
+                    Adopt(old_children_node_ptr, children_node_ptr, adopted_nodes);
+                    break;
+                }
+            }
+        }
+    }
+
+    // 后序遍历，子节点先于父节点复位，每个节点只终止一次
+    static void ResetRunningNodes(const BehaviorNode::Ptr &node_ptr)
+    {
+        std::vector<BehaviorNode::Ptr> children;
+        GetChildren(node_ptr, children);
+        for (auto &children_node_ptr : children) {
+            ResetRunningNodes(children_node_ptr);
+        }
+        if (node_ptr->GetBehaviorState() == BehaviorState::RUNNING) {
+            node_ptr->Reset();
+        }
+    }
+
+    static void GetChildren(const BehaviorNode::Ptr &node_ptr, std::vector<BehaviorNode::Ptr> &children)
+    {
+        auto composite_node_ptr = std::dynamic_pointer_cast<CompositeNode>(node_ptr);
+        if (composite_node_ptr) {
+            children = composite_node_ptr->GetChildren();
+        } else if (node_ptr->GetChild() != nullptr) {
+            children.push_back(node_ptr->GetChild());
+        }
+    }
+
+    static void CollectNodes(const BehaviorNode::Ptr &node_ptr, std::unordered_set<BehaviorNode*> &nodes)
+    {
+        nodes.insert(node_ptr.get());
+        std::vector<BehaviorNode::Ptr> children;
+        GetChildren(node_ptr, children);
+        for (auto &children_node_ptr : children) {
+            CollectNodes(children_node_ptr, nodes);
+        }
+    }
+
+    static bool Shares(const BehaviorNode::Ptr &node_ptr, const std::unordered_set<BehaviorNode*> &nodes)
+    {
+        if (nodes.count(node_ptr.get())) {
+            return true;
+        }
+        std::vector<BehaviorNode::Ptr> children;
+        GetChildren(node_ptr, children);
+        for (auto &children_node_ptr : children) {
+            if (Shares(children_node_ptr, nodes)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     BehaviorNode::Ptr root_node_;
     BlackBoard::Ptr blackboard_;
     std::chrono::milliseconds cycle_duration_;
+    std::chrono::microseconds tick_budget_;
+    bool preempted_;
+    SubtreeEvictor::Ptr subtree_evictor_;
+    ShmBinding::Ptr shm_binding_;
+    StatePublisher::Ptr state_publisher_;
+    // 等待替换的新树
+    std::mutex swap_mutex_;
+    BehaviorNode::Ptr pending_root_node_;
+    std::atomic<bool> swap_pending_;
+    std::atomic<SwapStatus> swap_status_;
 };
 
 #endif
@@ -0,0 +1,258 @@
+#ifndef DECORATOR_NODES_H
+#define DECORATOR_NODES_H
+
+#include<behavior_node.h>
+#include<chrono>
+
+/**
+ * @brief 冷却节点：子节点结束（或被终止）后的cooldown_时间内不再进入子节点，直接返回FAILURE
+ * 时间以黑板上的时钟为准（见BehaviorTree::Tick）
+ */
+class CooldownNode : public DecoratorNode
+{
+  public:
+    CooldownNode(std::string name, const BlackBoard::Ptr &blackboard_ptr, std::chrono::milliseconds cooldown) :
+      DecoratorNode::DecoratorNode(name, BehaviorType::COOLDOWN, blackboard_ptr),
+      cooldown_(cooldown),
+      finished_(false),
+      blocked_(false){}
+
+    virtual ~CooldownNode(){}
+
+  protected:
+    virtual void OnInitialize(){}
+
+    virtual BehaviorState Update()
+    {
+      blocked_ = child_node_ptr_->GetBehaviorState() != BehaviorState::RUNNING
+          && finished_ && blackboard_ptr_->now - finish_time_ < cooldown_;
+      if (blocked_) {
+        return BehaviorState::FAILURE;
+      }
+      return child_node_ptr_->Run();
+    }
+
+    virtual void OnTerminate(BehaviorState state)
+    {
+      switch (state){
+        case BehaviorState::IDLE:
+          ResetRunning(child_node_ptr_);
+          break;
+        case BehaviorState::SUCCESS:
+          break;
+        case BehaviorState::FAILURE:
+          break;
+        default:
+          return;
+      }
+      // 冷却中被拒绝的那次不重新计时
+      if (!blocked_) {
+        finished_ = true;
+        finish_time_ = blackboard_ptr_->now;
+      }
+    }
+
+    virtual bool AdoptState(const BehaviorNode::Ptr &old_node_ptr)
+    {
+      auto old_cooldown_node_ptr = std::dynamic_pointer_cast<CooldownNode>(old_node_ptr);
+      if (!old_cooldown_node_ptr) {
+        return false;
+      }
+      finish_time_ = old_cooldown_node_ptr->finish_time_;
+      finished_ = old_cooldown_node_ptr->finished_;
+      blocked_ = old_cooldown_node_ptr->blocked_;
+      return true;
+    }
+
+    std::chrono::milliseconds cooldown_;
+    std::chrono::steady_clock::time_point finish_time_;
+    bool finished_;
+    bool blocked_;
+};
+
+/**
+ * @brief 节流节点：运行子节点后的interval_次遍历内不再运行子节点，直接返回上一次的结果
+ * 遍历次数按整棵树计（黑板上的tick，见BehaviorTree::Tick），所在分支很久没有进入时，再次进入会重新运行子节点。
+ * 上一次结果为RUNNING时，子节点保持运行状态，只是这几次遍历不更新
+ */
+class ThrottleNode : public DecoratorNode
+{
+  public:
+    ThrottleNode(std::string name, const BlackBoard::Ptr &blackboard_ptr, unsigned int interval) :
+      DecoratorNode::DecoratorNode(name, BehaviorType::THROTTLE, blackboard_ptr),
+      interval_(interval),
+      evaluated_tick_(0),
+      cached_(false),
+      cached_state_(BehaviorState::IDLE){}
+
+    virtual ~ThrottleNode(){}
+
+  protected:
+    virtual void OnInitialize(){}
+
+    virtual BehaviorState Update()
+    {
+      if (cached_ && blackboard_ptr_->tick - evaluated_tick_ < interval_) {
+        return cached_state_;
+      }
+      evaluated_tick_ = blackboard_ptr_->tick;
+      cached_state_ = child_node_ptr_->Run();
+      cached_ = true;
+      return cached_state_;
+    }
+
+    virtual void OnTerminate(BehaviorState state)
+    {
+      switch (state){
+        case BehaviorState::IDLE:
+          // 被终止时子节点不再运行，缓存的RUNNING失效
+          ResetRunning(child_node_ptr_);
+          if (cached_state_ == BehaviorState::RUNNING) {
+            cached_ = false;
+          }
+          break;
+        case BehaviorState::SUCCESS:
+          break;
+        case BehaviorState::FAILURE:
+          break;
+        default:
+          return;
+      }
+    }
+
+    virtual bool AdoptState(const BehaviorNode::Ptr &old_node_ptr)
+    {
+      auto old_throttle_node_ptr = std::dynamic_pointer_cast<ThrottleNode>(old_node_ptr);
+      if (!old_throttle_node_ptr) {
+        return false;
+      }
+      evaluated_tick_ = old_throttle_node_ptr->evaluated_tick_;
+      cached_ = old_throttle_node_ptr->cached_;
+      cached_state_ = old_throttle_node_ptr->cached_state_;
+      return true;
+    }
+
+    unsigned int interval_;
+    // 上一次运行子节点时的遍历计数
+    uint64_t evaluated_tick_;
+    bool cached_;
+    BehaviorState cached_state_;
+};
+
+/**
+ * @brief 超时节点：子节点连续运行超过timeout_后终止子节点并返回FAILURE
+ */
+class TimeoutNode : public DecoratorNode
+{
+  public:
+    TimeoutNode(std::string name, const BlackBoard::Ptr &blackboard_ptr, std::chrono::milliseconds timeout) :
+      DecoratorNode::DecoratorNode(name, BehaviorType::TIMEOUT, blackboard_ptr),
+      timeout_(timeout){}
+
+    virtual ~TimeoutNode(){}
+
+  protected:
+    virtual void OnInitialize()
+    {
+      start_time_ = blackboard_ptr_->now;
+    }
+
+    virtual BehaviorState Update()
+    {
+      if (blackboard_ptr_->now - start_time_ >= timeout_) {
+        return BehaviorState::FAILURE;
+      }
+      return child_node_ptr_->Run();
+    }
+
+    virtual void OnTerminate(BehaviorState state)
+    {
+      switch (state){
+        case BehaviorState::IDLE:
+          ResetRunning(child_node_ptr_);
+          break;
+        case BehaviorState::SUCCESS:
+          break;
+        case BehaviorState::FAILURE:
+          // 超时时子节点仍在运行
+          ResetRunning(child_node_ptr_);
+          break;
+        default:
+          return;
+      }
+    }
+
+    // 沿用旧节点的开始时间，替换不会延长超时
+    virtual bool AdoptState(const BehaviorNode::Ptr &old_node_ptr)
+    {
+      auto old_timeout_node_ptr = std::dynamic_pointer_cast<TimeoutNode>(old_node_ptr);
+      if (!old_timeout_node_ptr) {
+        return false;
+      }
+      start_time_ = old_timeout_node_ptr->start_time_;
+      return true;
+    }
+
+    std::chrono::milliseconds timeout_;
+    std::chrono::steady_clock::time_point start_time_;
+};
+
+/**
+ * @brief 重试节点：子节点失败后在下一次遍历重新运行，最多尝试max_attempts_次，0表示不限次数
+ * 每次遍历最多运行一次子节点，失败的子节点不会在同一帧内被反复重启
+ */
+class RetryNode : public DecoratorNode
+{
+  public:
+    RetryNode(std::string name, const BlackBoard::Ptr &blackboard_ptr, unsigned int max_attempts) :
+      DecoratorNode::DecoratorNode(name, BehaviorType::RETRY, blackboard_ptr),
+      max_attempts_(max_attempts),
+      attempts_(0){}
+
+    virtual ~RetryNode(){}
+
+  protected:
+    virtual void OnInitialize()
+    {
+      attempts_ = 0;
+    }
+
+    virtual BehaviorState Update()
+    {
+      BehaviorState state = child_node_ptr_->Run();
+      if (state == BehaviorState::FAILURE && (max_attempts_ == 0 || ++attempts_ < max_attempts_)) {
+        return BehaviorState::RUNNING;
+      }
+      return state;
+    }
+
+    virtual void OnTerminate(BehaviorState state)
+    {
+      switch (state){
+        case BehaviorState::IDLE:
+          ResetRunning(child_node_ptr_);
+          break;
+        case BehaviorState::SUCCESS:
+          break;
+        case BehaviorState::FAILURE:
+          break;
+        default:
+          return;
+      }
+    }
+
+    virtual bool AdoptState(const BehaviorNode::Ptr &old_node_ptr)
+    {
+      auto old_retry_node_ptr = std::dynamic_pointer_cast<RetryNode>(old_node_ptr);
+      if (!old_retry_node_ptr) {
+        return false;
+      }
+      attempts_ = old_retry_node_ptr->attempts_;
+      return true;
+    }
+
+    unsigned int max_attempts_;
+    unsigned int attempts_;
+};
+
+#endif
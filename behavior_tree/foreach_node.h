@@ -0,0 +1,241 @@
+#ifndef FOREACH_NODE_H
+#define FOREACH_NODE_H
+
+#include<behavior_node.h>
+#include<worker_pool.h>
+
+/**
+ * @brief 对黑板上集合中的每个元素运行一棵子树
+ * @details 节点开始运行时读取集合，为每个元素准备一个状态槽（元素、子树、运行结果），
+ * 子树由subtree_function按元素创建，元素不变时复用上一次的子树。
+ * 结果汇总方式参照ParallelNode：成功的元素数达到threshold_时返回SUCCESS，
+ * 失败的元素多到不可能再达到threshold_时返回FAILURE，否则返回RUNNING并在下一次遍历继续未完成的元素。
+ * 指定worker_pool后，未完成的元素按chunk_size分块在线程池中并行运行，
+ * 此时子树只能读取黑板，写入应限于各自元素的数据，NodeInfo的输出也会交错。
+ */
+template<typename T>
+class ForEachNode : public BehaviorNode
+{
+  public:
+    typedef std::function<std::vector<T>()> CollectionFunction;
+    typedef std::function<BehaviorNode::Ptr(const T &element)> SubtreeFunction;
+
+    /**
+     * @brief 节点构造器
+     * @param name 节点名称标识
+     * @param collection_function 返回黑板上的集合
+     * @param subtree_function 为元素创建子树
+     * @param threshold 返回SUCCESS所需的成功元素数，0或超过元素数时表示全部元素
+     * @param worker_pool 不为空时并行运行各元素的子树
+     * @param chunk_size 并行时每块的元素数
+     */
+    ForEachNode(std::string name, const BlackBoard::Ptr &blackboard_ptr,
+                CollectionFunction collection_function, SubtreeFunction subtree_function,
+                unsigned int threshold = 0, const WorkerPool::Ptr &worker_pool = nullptr, unsigned int chunk_size = 64) :
+      BehaviorNode::BehaviorNode(name, BehaviorType::FOREACH, blackboard_ptr),
+      collection_function_(collection_function),
+      subtree_function_(subtree_function),
+      threshold_(threshold),
+      worker_pool_(worker_pool),
+      chunk_size_(chunk_size),
+      success_count_(0),
+      failure_count_(0),
+      slot_index_(0){}
+
+    // 元素子树随本节点一起释放，不能留在监听者的登记中
+    virtual ~ForEachNode()
+    {
+      if (state_listener_ != nullptr) {
+        for (auto &slot : slots_) {
+          if (slot.node_ptr) {
+            state_listener_->OnSubtreeDetached(slot.node_ptr);
+          }
+        }
+      }
+    }
+
+    virtual void GetDynamicChildren(std::vector<BehaviorNode::Ptr> &children)
+    {
+      for (auto &slot : slots_) {
+        if (slot.node_ptr) {
+          children.push_back(slot.node_ptr);
+        }
+      }
+    }
+
+  protected:
+    // 每个元素的状态槽
+    struct Slot
+    {
+      T element;
+      BehaviorNode::Ptr node_ptr;
+      BehaviorState state;
+      bool done;
+    };
+
+    virtual void OnInitialize()
+    {
+      std::vector<T> collection = collection_function_();
+      if (state_listener_ != nullptr) {
+        for (unsigned int index = collection.size(); index < slots_.size(); index++) {
+          if (slots_.at(index).node_ptr) {
+            state_listener_->OnSubtreeDetached(slots_.at(index).node_ptr);
+          }
+        }
+      }
+      slots_.resize(collection.size());
+      for (unsigned int index = 0; index < collection.size(); index++)
+      {
+        Slot &slot = slots_.at(index);
+        if (slot.node_ptr == nullptr || !(slot.element == collection.at(index)))
+        {
+          if (state_listener_ != nullptr && slot.node_ptr) {
+            state_listener_->OnSubtreeDetached(slot.node_ptr);
+          }
+          slot.element = collection.at(index);
+          slot.node_ptr = subtree_function_(slot.element);
+          slot.node_ptr->SetParent(shared_from_this());
+        }
+        // 新建的子树，或在设置监听者之前创建的子树
+        if (state_listener_ != nullptr && slot.node_ptr->GetStateListener() != state_listener_) {
+          state_listener_->OnSubtreeAttached(shared_from_this(), slot.node_ptr);
+        }
+        slot.state = BehaviorState::IDLE;
+        slot.done = false;
+      }
+      success_count_ = 0;
+      failure_count_ = 0;
+      slot_index_ = 0;
+      slot_running_.assign(slots_.size(), false);
+      running_slots_.clear();
+    }
+
+    virtual BehaviorState Update()
+    {
+      if (slots_.empty()) {
+        return BehaviorState::SUCCESS;
+      }
+
+      if (worker_pool_) {
+        RunParallel();
+      } else if (!RunSequential()) {
+        // 预算耗尽，下一次遍历从slot_index_继续
+        return BehaviorState::RUNNING;
+      }
+
+      // 集合比threshold_小时要求全部成功
+      unsigned int threshold = threshold_ == 0 ? slots_.size() : std::min<unsigned int>(threshold_, slots_.size());
+      for (unsigned int index = 0; index < slots_.size(); index++)
+      {
+        Slot &slot = slots_.at(index);
+        if (slot.done) {
+          continue;
+        }
+        if (slot.state == BehaviorState::SUCCESS) {
+          slot.done = true;
+          success_count_++;
+        } else if (slot.state == BehaviorState::FAILURE) {
+          slot.done = true;
+          failure_count_++;
+        } else if (slot.state == BehaviorState::RUNNING) {
+          MarkRunning(index);
+        }
+      }
+
+      if (success_count_ >= threshold) {
+        return BehaviorState::SUCCESS;
+      }
+      // 剩下的元素全部成功也达不到threshold
+      if (failure_count_ > slots_.size() - threshold) {
+        return BehaviorState::FAILURE;
+      }
+      return BehaviorState::RUNNING;
+    }
+
+    // 依次运行未完成的元素，预算耗尽时返回false
+    bool RunSequential()
+    {
+      bool slot_run = false;
+      for (; slot_index_ < slots_.size(); slot_index_++)
+      {
+        Slot &slot = slots_.at(slot_index_);
+        if (slot.done) {
+          continue;
+        }
+        if (slot_run && TickBudget::ShouldYield()) {
+          return false;
+        }
+        slot.state = slot.node_ptr->Run();
+        slot_run = true;
+        // 预算耗尽时不会经过Update中的汇总，此时终止也要能复位该元素
+        if (slot.state == BehaviorState::RUNNING) {
+          MarkRunning(slot_index_);
+        }
+      }
+      slot_index_ = 0;
+      return true;
+    }
+
+    void MarkRunning(unsigned int index)
+    {
+      if (!slot_running_.at(index)) {
+        slot_running_.at(index) = true;
+        running_slots_.push_back(index);
+      }
+    }
+
+    void RunParallel()
+    {
+      pending_slots_.clear();
+      for (unsigned int index = 0; index < slots_.size(); index++) {
+        if (!slots_.at(index).done) {
+          pending_slots_.push_back(index);
+        }
+      }
+      worker_pool_->ParallelFor(pending_slots_.size(), chunk_size_, [this](size_t begin, size_t end){
+        for (size_t index = begin; index < end; index++) {
+          Slot &slot = slots_.at(pending_slots_.at(index));
+          slot.state = slot.node_ptr->Run();
+        }
+      });
+    }
+
+    // 只复位还在运行的元素子树
+    virtual void OnTerminate(BehaviorState state)
+    {
+      switch (state){
+        case BehaviorState::IDLE:
+          break;
+        case BehaviorState::SUCCESS:
+          break;
+        case BehaviorState::FAILURE:
+          break;
+        default:
+          return;
+      }
+      for (auto index : running_slots_) {
+        slot_running_.at(index) = false;
+        if (index < slots_.size()) {
+          ResetRunning(slots_.at(index).node_ptr);
+        }
+      }
+      running_slots_.clear();
+    }
+
+    CollectionFunction collection_function_;
+    SubtreeFunction subtree_function_;
+    unsigned int threshold_;
+    WorkerPool::Ptr worker_pool_;
+    unsigned int chunk_size_;
+    unsigned int success_count_;
+    unsigned int failure_count_;
+    // 预算耗尽时记录下一个待运行的元素
+    unsigned int slot_index_;
+    std::vector<Slot> slots_;
+    // 返回过RUNNING的元素，终止时只需复位这些子树
+    std::vector<bool> slot_running_;
+    std::vector<unsigned int> running_slots_;
+    std::vector<unsigned int> pending_slots_;
+};
+
+#endif
@@ -0,0 +1,261 @@
+#ifndef INDEXED_SELECTOR_NODE_H
+#define INDEXED_SELECTOR_NODE_H
+
+#include<behavior_node.h>
+#include<blackboard.h>
+#include<map>
+#include<set>
+#include<unordered_map>
+
+/**
+ * @brief 适用于子节点非常多的选择节点
+ * @details SelectorNode每帧都要线性扫描运行节点左侧的所有条件节点，失败时再向右线性扫描。
+ * IndexedSelectorNode为每个条件子节点登记其依赖的黑板数据项，只在这些数据项变化后才重新评估条件，
+ * 并用有序集合维护当前满足条件的子节点编号：
+ *   eligible_   ：无条件子节点 + 条件满足的条件子节点，失败后向右查找下一个子节点
+ *   preemptive_ ：条件满足且终止类型为LOW_PRIORITY/BOTH的条件子节点，用于抢占低优先级节点
+ * 选出优先级最高的可运行子节点的代价为O(log K)，终止语义与SelectorNode一致。
+ * 注意：条件函数只能依赖登记过的黑板数据项，否则集合中的评估结果可能过期。
+ */
+class IndexedSelectorNode : public SelectorNode
+{
+  public:
+    IndexedSelectorNode(std::string name, const BlackBoard::Ptr &blackboard_ptr) :
+      SelectorNode::SelectorNode(name, blackboard_ptr),
+      subscription_(0){}
+
+    // 节点会随子树回收、热替换而释放，不能在黑板上留下订阅
+    virtual ~IndexedSelectorNode()
+    {
+      if (subscription_ != 0) {
+        blackboard_ptr_->Unsubscribe(subscription_);
+      }
+    }
+
+    // 未声明依赖的条件子节点视为依赖全部黑板数据项
+    virtual void AddChildren(const BehaviorNode::Ptr &children_node_ptr)
+    {
+      AddChildren(children_node_ptr, std::vector<BlackBoardKey>());
+    }
+
+    /**
+     * @brief 添加子节点，并登记条件子节点依赖的黑板数据项
+     * @param children_node_ptr 子节点
+     * @param dependencies 条件子节点的准入条件所读取的黑板数据项
+     */
+    void AddChildren(const BehaviorNode::Ptr &children_node_ptr, const std::vector<BlackBoardKey> &dependencies)
+    {
+      SelectorNode::AddChildren(children_node_ptr);
+      unsigned int index = children_node_ptr_.size() - 1;
+      children_node_index_map_[children_node_ptr.get()] = index;
+
+      std::shared_ptr<PreconditionNode> guard_ptr;
+      if (children_node_ptr->GetBehaviorType() == BehaviorType::PRECONDITION) {
+        guard_ptr = std::dynamic_pointer_cast<PreconditionNode>(children_node_ptr);
+      }
+      guard_node_ptr_.push_back(guard_ptr);
+      guard_dirty_.push_back(false);
+
+      if (!guard_ptr) {
+        eligible_.insert(index);
+        return;
+      }
+
+      if (dependencies.empty()) {
+        all_keys_guards_.push_back(index);
+      }
+      for (auto key : dependencies) {
+        key_guards_[key].push_back(index);
+      }
+      MarkDirty(index);
+    }
+
+    // 替换后的条件子节点沿用原位置登记的依赖，原位置不是条件子节点时视为依赖全部黑板数据项
+    virtual void ReplaceChild(unsigned int index, const BehaviorNode::Ptr &children_node_ptr)
+    {
+      children_node_index_map_.erase(children_node_ptr_.at(index).get());
+      SelectorNode::ReplaceChild(index, children_node_ptr);
+      children_node_index_map_[children_node_ptr.get()] = index;
+
+      std::shared_ptr<PreconditionNode> guard_ptr;
+      if (children_node_ptr->GetBehaviorType() == BehaviorType::PRECONDITION) {
+        guard_ptr = std::dynamic_pointer_cast<PreconditionNode>(children_node_ptr);
+      }
+      if (guard_ptr && !guard_node_ptr_.at(index)) {
+        all_keys_guards_.push_back(index);
+      }
+      guard_node_ptr_.at(index) = guard_ptr;
+
+      if (guard_ptr) {
+        MarkDirty(index);
+      } else {
+        eligible_.insert(index);
+        preemptive_.erase(index);
+      }
+    }
+
+    // 依赖登记与子节点位置绑定，随子节点一起清空，黑板上的订阅保留
+    virtual void ClearChildren()
+    {
+      SelectorNode::ClearChildren();
+      children_node_index_map_.clear();
+      guard_node_ptr_.clear();
+      key_guards_.clear();
+      all_keys_guards_.clear();
+      guard_dirty_.clear();
+      dirty_guards_.clear();
+      eligible_.clear();
+      preemptive_.clear();
+    }
+
+    virtual int GetChildIndex(const BehaviorNode::Ptr &children_node_ptr)
+    {
+      auto iter = children_node_index_map_.find(children_node_ptr.get());
+      if (iter == children_node_index_map_.end()) {
+        return -1;
+      }
+      return iter->second;
+    }
+
+  protected:
+    virtual BehaviorState Update()
+    {
+      if (children_node_ptr_.size() == 0) {
+        return BehaviorState::SUCCESS;
+      }
+
+      // 首次遍历时才订阅黑板，树因此可以在其他线程上构建（见BehaviorTree::Swap），
+      // 订阅前新添加的条件节点都已标记为待评估
+      Subscribe();
+      RefreshGuards();
+
+      // 查看是否需要终止低优先级节点，只访问满足条件且位于运行节点左侧的条件节点
+      for (auto iter = preemptive_.begin();
+           iter != preemptive_.end() && *iter < children_node_index_; ++iter)
+      {
+        unsigned int index = *iter;
+        BehaviorState state = children_node_ptr_.at(index)->Run();
+        // 同SelectorNode：抢占成功时children_node_index_会被设置为index
+        if (index == children_node_index_)
+        {
+          if (state != BehaviorState::FAILURE)
+          {
+            return state;
+          }
+          return RunFrom(NextEligible(children_node_index_));
+        }
+      }
+
+      // 正在运行的子节点直接继续，否则从当前位置起第一个可运行的子节点开始
+      if (children_node_ptr_.at(children_node_index_)->GetBehaviorState() == BehaviorState::RUNNING) {
+        return RunFrom(children_node_index_);
+      }
+      auto iter = eligible_.lower_bound(children_node_index_);
+      return RunFrom(iter == eligible_.end() ? children_node_ptr_.size() : *iter);
+    }
+
+    // 从index开始依次运行可运行的子节点，语义同SelectorNode中的while循环
+    BehaviorState RunFrom(unsigned int index)
+    {
+      while (index < children_node_ptr_.size())
+      {
+        children_node_index_ = index;
+        BehaviorState state = children_node_ptr_.at(children_node_index_)->Run();
+        if (state != BehaviorState::FAILURE)
+        {
+          return state;
+        }
+        index = NextEligible(children_node_index_);
+        // 预算耗尽，下一次遍历从下一个可运行的子节点继续
+        if (index < children_node_ptr_.size() && TickBudget::ShouldYield())
+        {
+          children_node_index_ = index;
+          return BehaviorState::RUNNING;
+        }
+      }
+      // 所有可运行的子节点都失败，终止自己
+      children_node_index_ = 0;
+      return BehaviorState::FAILURE;
+    }
+
+    // 已运行的子节点可能改写了黑板，先重新评估被标记的条件，保证与SelectorNode逐个评估的结果一致
+    unsigned int NextEligible(unsigned int index)
+    {
+      RefreshGuards();
+      auto iter = eligible_.upper_bound(index);
+      return iter == eligible_.end() ? children_node_ptr_.size() : *iter;
+    }
+
+    void Subscribe()
+    {
+      if (subscription_ != 0) {
+        return;
+      }
+      // 用weak_ptr避免黑板与节点之间的循环引用
+      std::weak_ptr<BehaviorNode> weak_ptr = shared_from_this();
+      subscription_ = blackboard_ptr_->Subscribe([weak_ptr](BlackBoardKey key){
+        auto node_ptr = std::static_pointer_cast<IndexedSelectorNode>(weak_ptr.lock());
+        if (node_ptr) {
+          node_ptr->OnBlackBoardChanged(key);
+        }
+      });
+    }
+
+    // 黑板数据变化时只做标记，真正的评估推迟到下一次Update，同一帧内的多次变化只评估一次
+    void OnBlackBoardChanged(BlackBoardKey key)
+    {
+      auto iter = key_guards_.find(key);
+      if (iter != key_guards_.end()) {
+        for (auto index : iter->second) {
+          MarkDirty(index);
+        }
+      }
+      for (auto index : all_keys_guards_) {
+        MarkDirty(index);
+      }
+    }
+
+    void MarkDirty(unsigned int index)
+    {
+      if (!guard_dirty_.at(index)) {
+        guard_dirty_.at(index) = true;
+        dirty_guards_.push_back(index);
+      }
+    }
+
+    void RefreshGuards()
+    {
+      for (auto index : dirty_guards_) {
+        guard_dirty_.at(index) = false;
+        auto &guard_ptr = guard_node_ptr_.at(index);
+        // 该位置已被替换为非条件节点
+        if (!guard_ptr) {
+          continue;
+        }
+        if (guard_ptr->CheckPrecondition()) {
+          eligible_.insert(index);
+          if (children_node_reevaluation_.at(index)) {
+            preemptive_.insert(index);
+          }
+        } else {
+          eligible_.erase(index);
+          preemptive_.erase(index);
+        }
+      }
+      dirty_guards_.clear();
+    }
+
+    // 0表示尚未订阅
+    unsigned int subscription_;
+    std::unordered_map<BehaviorNode*, unsigned int> children_node_index_map_;
+    // 非条件子节点对应位置为空
+    std::vector<std::shared_ptr<PreconditionNode>> guard_node_ptr_;
+    std::map<BlackBoardKey, std::vector<unsigned int>> key_guards_;
+    std::vector<unsigned int> all_keys_guards_;
+    std::vector<bool> guard_dirty_;
+    std::vector<unsigned int> dirty_guards_;
+    std::set<unsigned int> eligible_;
+    std::set<unsigned int> preemptive_;
+};
+
+#endif
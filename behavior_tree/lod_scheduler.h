@@ -0,0 +1,322 @@
+#ifndef LOD_SCHEDULER_H
+#define LOD_SCHEDULER_H
+
+#include<behavior_tree.h>
+#include<algorithm>
+#include<numeric>
+
+/**
+ * @brief 多智能体分级遍历调度器
+ * @details 每个智能体按黑板上的importance分到一个级别，第i级每periods[i]帧遍历一次。
+ * 同一级别的智能体被均匀错开到不同相位，每帧实际遍历的智能体数量保持平稳；
+ * 设置了每帧遍历上限后，超出的负载由importance最低的智能体依次降级承担。
+ * 动作节点以黑板上的时钟计时（见BehaviorTree::Tick），降频后仍按真实经过的时间完成。
+ */
+class LodScheduler
+{
+  public:
+    typedef std::shared_ptr<LodScheduler> Ptr;
+
+    /**
+     * @brief 调度器构造器
+     * @param frame_duration 帧周期（毫秒）
+     * @param periods 各级别的遍历间隔（帧），从高频到低频排列
+     * @param thresholds 各级别的importance下限，与periods一一对应且递减
+     * @param hysteresis 降级时需要低于下限的幅度，避免在门限附近反复升降级
+     */
+    LodScheduler(int frame_duration, const std::vector<unsigned int> &periods,
+                 const std::vector<float> &thresholds, float hysteresis = 0.05f):
+      frame_duration_(frame_duration),
+      periods_(periods),
+      thresholds_(thresholds),
+      hysteresis_(hysteresis),
+      frame_(0),
+      max_ticks_per_frame_(0),
+      ticks_last_frame_(0),
+      frame_budget_(0),
+      load_(0),
+      rebalance_(false)
+    {
+      buckets_.resize(periods_.size());
+      for (unsigned int level = 0; level < periods_.size(); level++) {
+        buckets_.at(level).resize(periods_.at(level));
+      }
+      rebalance_interval_ = *std::max_element(periods_.begin(), periods_.end());
+    }
+
+    // 添加智能体，返回其编号
+    unsigned int AddAgent(const BehaviorTree::Ptr &tree)
+    {
+      Agent agent;
+      agent.tree = tree;
+      agent.natural_level = DesiredLevel(tree->GetBlackBoard()->getImportance(), periods_.size() - 1);
+      agent.min_level = 0;
+      agents_.push_back(agent);
+      pending_.push_back(false);
+      AddToBucket(agents_.size() - 1, agent.natural_level);
+      // 没有上限时新智能体直接处于自然级别，无需重新计算
+      if (max_ticks_per_frame_ != 0) {
+        rebalance_ = true;
+      }
+      return agents_.size() - 1;
+    }
+
+    /**
+     * @brief 整体替换所有智能体的行为树
+     * @param root_function 为智能体的黑板创建新树，在调用线程上为每个智能体各调用一次
+     * @details 每棵树在各自的下一次遍历前完成替换，运行状态的接管方式与替换结果见BehaviorTree::Swap
+     * @return 有新树校验失败时返回false，这些智能体保持原来的树
+     */
+    bool Swap(const std::function<BehaviorNode::Ptr(const BlackBoard::Ptr &blackboard_ptr)> &root_function)
+    {
+      bool swapped = true;
+      for (auto &agent : agents_) {
+        if (!agent.tree->Swap(root_function(agent.tree->GetBlackBoard()))) {
+          swapped = false;
+        }
+      }
+      return swapped;
+    }
+
+    // 每帧遍历次数上限（按平均负载计），0表示不限制
+    void SetMaxTicksPerFrame(unsigned int max_ticks_per_frame)
+    {
+      max_ticks_per_frame_ = max_ticks_per_frame;
+      rebalance_ = true;
+    }
+
+    /**
+     * @brief 设置每帧的总遍历预算，0表示不限时
+     * @details 每个到期的智能体分得剩余预算的均分份额，预算耗尽时在安全点中断（见TickBudget）；
+     * 被中断或本帧没有轮到的智能体会在下一帧优先继续，从而保证每帧不超时。
+     * 帧开始时的级别调整（见Rebalance）同样计入本帧预算，超出部分最多为一次遍历的耗时
+     */
+    void SetFrameBudget(std::chrono::microseconds frame_budget)
+    {
+      frame_budget_ = frame_budget;
+    }
+
+    // 推进一帧：按遍历上限调整级别，再遍历本帧到期的智能体，最后根据importance调整级别
+    void Step()
+    {
+      std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + frame_budget_;
+      ticks_last_frame_ = 0;
+      // 没有上限时不存在由上限带来的降级，只在上限刚被取消时复位一次
+      if (rebalance_ || (max_ticks_per_frame_ != 0 && frame_ % rebalance_interval_ == 0)) {
+        Rebalance();
+      }
+
+      // 上一帧未完成的智能体优先
+      std::vector<unsigned int> due_agents;
+      due_agents.swap(pending_agents_);
+      for (unsigned int level = 0; level < periods_.size(); level++)
+      {
+        for (auto id : buckets_.at(level).at(frame_ % periods_.at(level)))
+        {
+          if (!pending_.at(id)) {
+            due_agents.push_back(id);
+          }
+        }
+      }
+
+      std::vector<unsigned int> moved_agents;
+      for (unsigned int index = 0; index < due_agents.size(); index++)
+      {
+        unsigned int id = due_agents.at(index);
+        Agent &agent = agents_.at(id);
+        pending_.at(id) = false;
+        if (frame_budget_ > std::chrono::microseconds(0))
+        {
+          std::chrono::microseconds remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+            deadline - std::chrono::steady_clock::now());
+          // 本帧预算已用完，剩下的智能体推迟到下一帧
+          if (remaining <= std::chrono::microseconds(0))
+          {
+            // 推迟的智能体可能很多，只写紧凑的标记而不访问智能体本身，这部分开销在截止时间之后
+            for (unsigned int rest = index; rest < due_agents.size(); rest++) {
+              pending_.at(due_agents.at(rest)) = true;
+            }
+            pending_agents_.insert(pending_agents_.end(), due_agents.begin() + index, due_agents.end());
+            break;
+          }
+          agent.tree->Tick(remaining / (due_agents.size() - index));
+          if (agent.tree->Preempted()) {
+            pending_.at(id) = true;
+            pending_agents_.push_back(id);
+          }
+        }
+        else
+        {
+          agent.tree->Tick();
+        }
+        ticks_last_frame_++;
+        agent.natural_level = DesiredLevel(agent.tree->GetBlackBoard()->getImportance(), agent.natural_level);
+        if (std::max(agent.natural_level, agent.min_level) != agent.level) {
+          moved_agents.push_back(id);
+        }
+      }
+      // 遍历结束后再调整所在分组，避免修改正在遍历的分组
+      for (auto id : moved_agents)
+      {
+        Agent &agent = agents_.at(id);
+        RemoveFromBucket(id);
+        AddToBucket(id, std::max(agent.natural_level, agent.min_level));
+      }
+
+      frame_++;
+    }
+
+    // 按帧周期连续运行frames帧
+    void Run(unsigned int frames)
+    {
+      for (unsigned int i = 0; i < frames; i++)
+      {
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        Step();
+        std::chrono::milliseconds execution_duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start_time);
+        std::chrono::milliseconds sleep_time = frame_duration_ - execution_duration;
+        if (sleep_time > std::chrono::milliseconds(0)) {
+          std::this_thread::sleep_for(sleep_time);
+        }
+      }
+    }
+
+    unsigned int GetLevel(unsigned int id)
+    {
+      return agents_.at(id).level;
+    }
+
+    unsigned int GetTicksLastFrame()
+    {
+      return ticks_last_frame_;
+    }
+
+    // 平均每帧遍历次数
+    double GetLoad()
+    {
+      return load_;
+    }
+
+  private:
+    struct Agent
+    {
+      BehaviorTree::Ptr tree;
+      // 由importance决定的级别
+      unsigned int natural_level;
+      // 由每帧遍历上限决定的最低级别
+      unsigned int min_level;
+      // 实际级别、相位以及在分组中的位置
+      unsigned int level;
+      unsigned int phase;
+      unsigned int bucket_index;
+    };
+
+    // 升级只需满足更高级别的下限，降级需要低于当前级别下限一个滞回量
+    unsigned int DesiredLevel(float importance, unsigned int current_level)
+    {
+      unsigned int level = 0;
+      while (level + 1 < periods_.size() && importance < thresholds_.at(level)) {
+        level++;
+      }
+      if (level > current_level && importance >= thresholds_.at(current_level) - hysteresis_) {
+        level = current_level;
+      }
+      return level;
+    }
+
+    // 放入该级别中智能体最少的相位，使低频智能体均匀分布在各帧
+    void AddToBucket(unsigned int id, unsigned int level)
+    {
+      auto &phases = buckets_.at(level);
+      unsigned int phase = 0;
+      for (unsigned int index = 1; index < phases.size(); index++) {
+        if (phases.at(index).size() < phases.at(phase).size()) {
+          phase = index;
+        }
+      }
+      Agent &agent = agents_.at(id);
+      agent.level = level;
+      agent.phase = phase;
+      agent.bucket_index = phases.at(phase).size();
+      phases.at(phase).push_back(id);
+      load_ += 1.0 / periods_.at(level);
+    }
+
+    void RemoveFromBucket(unsigned int id)
+    {
+      Agent &agent = agents_.at(id);
+      auto &bucket = buckets_.at(agent.level).at(agent.phase);
+      // 与末尾元素交换后删除
+      unsigned int last_id = bucket.back();
+      bucket.at(agent.bucket_index) = last_id;
+      agents_.at(last_id).bucket_index = agent.bucket_index;
+      bucket.pop_back();
+      load_ -= 1.0 / periods_.at(agent.level);
+    }
+
+    // 重新计算由遍历上限带来的降级：从importance最低的智能体开始逐级降级，直到负载不超过上限
+    void Rebalance()
+    {
+      rebalance_ = false;
+      std::vector<unsigned int> levels(agents_.size());
+      double load = 0;
+      for (unsigned int id = 0; id < agents_.size(); id++) {
+        levels.at(id) = agents_.at(id).natural_level;
+        load += 1.0 / periods_.at(levels.at(id));
+      }
+
+      if (max_ticks_per_frame_ != 0 && load > max_ticks_per_frame_)
+      {
+        std::vector<unsigned int> order(agents_.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b){
+          return agents_.at(a).tree->GetBlackBoard()->getImportance() < agents_.at(b).tree->GetBlackBoard()->getImportance();
+        });
+        bool demoted = true;
+        while (load > max_ticks_per_frame_ && demoted)
+        {
+          demoted = false;
+          for (unsigned int i = 0; i < order.size() && load > max_ticks_per_frame_; i++)
+          {
+            unsigned int &level = levels.at(order.at(i));
+            if (level + 1 < periods_.size()) {
+              load -= 1.0 / periods_.at(level) - 1.0 / periods_.at(level + 1);
+              level++;
+              demoted = true;
+            }
+          }
+        }
+      }
+
+      for (unsigned int id = 0; id < agents_.size(); id++)
+      {
+        Agent &agent = agents_.at(id);
+        agent.min_level = levels.at(id) > agent.natural_level ? levels.at(id) : 0;
+        if (levels.at(id) != agent.level) {
+          RemoveFromBucket(id);
+          AddToBucket(id, levels.at(id));
+        }
+      }
+    }
+
+    std::chrono::milliseconds frame_duration_;
+    std::vector<unsigned int> periods_;
+    std::vector<float> thresholds_;
+    float hysteresis_;
+    unsigned int frame_;
+    unsigned int max_ticks_per_frame_;
+    unsigned int ticks_last_frame_;
+    unsigned int rebalance_interval_;
+    std::chrono::microseconds frame_budget_;
+    double load_;
+    bool rebalance_;
+    std::vector<Agent> agents_;
+    std::vector<unsigned int> pending_agents_;
+    // pending_[id]：上一帧被中断或推迟，下一帧需要继续
+    std::vector<bool> pending_;
+    // buckets_[level][phase]为该级别该相位的智能体编号
+    std::vector<std::vector<std::vector<unsigned int>>> buckets_;
+};
+
+#endif
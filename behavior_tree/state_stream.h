@@ -0,0 +1,394 @@
+#ifndef STATE_STREAM_H
+#define STATE_STREAM_H
+
+#include<behavior_node.h>
+#include<cerrno>
+#include<cstring>
+#include<mutex>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<unistd.h>
+
+/**
+ * 状态变化流的消息格式，每个数据报一条消息，整数均为LEB128变长编码：
+ *   消息头       ：type(1字节) tree_id epoch sequence
+ *   SCHEMA_BEGIN ：node_count                                 接收端清空节点表
+ *   SCHEMA_NODES ：count {id parent_id+1 type(1字节) state(1字节) name_length name}
+ *   FRAME        ：tick count {id<<3 | abort<<2 | state}      tick为本树的遍历次数（BlackBoard::tick）
+ * epoch在每次重发节点表时加一，接收端丢弃epoch与当前节点表不一致的FRAME；
+ * sequence逐条消息加一，接收端据此发现丢失的消息。
+ */
+enum class StateMessageType : uint8_t
+{
+    SCHEMA_BEGIN = 1,
+    SCHEMA_NODES = 2,
+    FRAME = 3
+};
+
+class StateStream
+{
+  public:
+    // 单条消息的最大长度，超出时拆分为多条
+    static const size_t MAX_MESSAGE_SIZE = 32 * 1024;
+
+    static void PutVarint(std::vector<uint8_t> &buffer, uint64_t value)
+    {
+      while (value >= 0x80) {
+        buffer.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+      }
+      buffer.push_back((uint8_t)value);
+    }
+
+    // 数据不完整时返回false
+    static bool GetVarint(const uint8_t *&data, const uint8_t *end, uint64_t &value)
+    {
+      value = 0;
+      for (unsigned int shift = 0; data < end && shift < 64; shift += 7)
+      {
+        uint8_t byte = *data++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+          return true;
+        }
+      }
+      return false;
+    }
+};
+
+/**
+ * @brief 把行为树的节点状态变化发布给外部调试器（见tools/tree_debugger.cpp）
+ * @details 只记录状态的实际变化，每帧在BehaviorTree::Tick结束时打包成一条消息，
+ * 通过非阻塞的Unix域数据报套接字发送。没有接收端或接收端来不及读取时直接丢弃，不会阻塞遍历；
+ * 丢弃后下一帧重发完整的节点表（包含各节点的当前状态），接收端因此总能恢复到一致的视图。
+ * 节点编号在Attach时按先序遍历分配，运行中创建、释放的子树（SubtreeNode、ForEachNode）通过
+ * StateListener的回调登记与注销。树结构应在Attach前搭建完成。
+ */
+class StatePublisher : public StateListener
+{
+  public:
+    typedef std::shared_ptr<StatePublisher> Ptr;
+
+    /**
+     * @param socket_path 接收端绑定的套接字路径
+     * @param tree_id 多棵树发布到同一接收端时用于区分
+     */
+    StatePublisher(const std::string &socket_path, uint32_t tree_id = 0) :
+      tree_id_(tree_id),
+      epoch_(0),
+      sequence_(0),
+      chunk_begin_(0),
+      event_count_(0),
+      schema_pending_(true),
+      sent_count_(0),
+      dropped_count_(0)
+    {
+      std::memset(&address_, 0, sizeof(address_));
+      address_.sun_family = AF_UNIX;
+      if (socket_path.size() >= sizeof(address_.sun_path)) {
+        std::cerr << "state stream socket path too long: " << socket_path << std::endl;
+        fd_ = -1;
+        return;
+      }
+      std::strncpy(address_.sun_path, socket_path.c_str(), sizeof(address_.sun_path) - 1);
+      fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+      if (fd_ < 0) {
+        std::cerr << "state stream socket failed: " << std::strerror(errno) << std::endl;
+      }
+    }
+
+    // 发布者先于节点释放时，节点上不能留下指向它的指针
+    virtual ~StatePublisher()
+    {
+      Clear();
+      if (fd_ >= 0) {
+        close(fd_);
+      }
+    }
+
+    bool IsOpen()
+    {
+      return fd_ >= 0;
+    }
+
+    // 为整棵树分配编号，此前登记的节点全部注销，未发送的状态变化作废
+    void Attach(const BehaviorNode::Ptr &root_node)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Clear();
+      Register(root_node, 0);
+      schema_pending_ = true;
+    }
+
+    // 注销所有节点，不再发布
+    void Detach()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Clear();
+    }
+
+    virtual void OnTransition(uint32_t node_id, BehaviorState state, bool abort)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // 当前消息已满时另起一条
+      if (events_.size() - chunk_begin_ >= StateStream::MAX_MESSAGE_SIZE - 32) {
+        chunks_.push_back(Chunk{chunk_begin_, events_.size(), event_count_});
+        chunk_begin_ = events_.size();
+        event_count_ = 0;
+      }
+      StateStream::PutVarint(events_, ((uint64_t)node_id << 3) | (abort ? 4 : 0) | (uint64_t)state);
+      event_count_++;
+    }
+
+    virtual void OnSubtreeAttached(const BehaviorNode::Ptr &parent_node_ptr, const BehaviorNode::Ptr &subtree_node_ptr)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (parent_node_ptr->GetStateListener() != this) {
+        return;
+      }
+      Register(subtree_node_ptr, parent_node_ptr->GetNodeId() + 1);
+      schema_pending_ = true;
+    }
+
+    virtual void OnSubtreeDetached(const BehaviorNode::Ptr &subtree_node_ptr)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Unregister(subtree_node_ptr);
+      schema_pending_ = true;
+    }
+
+    // 发送本帧的状态变化，由BehaviorTree::Tick在遍历结束后调用，tick为本树的遍历次数，调试器据此对应各帧
+    void Flush(uint64_t tick)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      // 本帧注销的编号此时才能复用，避免本帧的状态变化被算到新节点上
+      free_ids_.insert(free_ids_.end(), released_ids_.begin(), released_ids_.end());
+      released_ids_.clear();
+      if (fd_ < 0) {
+        ClearEvents();
+        return;
+      }
+
+      // 节点表中带有当前状态，发送成功后本帧的状态变化不再需要
+      if (schema_pending_) {
+        schema_pending_ = !SendSchema();
+        ClearEvents();
+        return;
+      }
+
+      if (event_count_ > 0) {
+        chunks_.push_back(Chunk{chunk_begin_, events_.size(), event_count_});
+      }
+      for (auto &chunk : chunks_)
+      {
+        BeginMessage(StateMessageType::FRAME);
+        StateStream::PutVarint(message_, tick);
+        StateStream::PutVarint(message_, chunk.count);
+        message_.insert(message_.end(), events_.begin() + chunk.begin, events_.begin() + chunk.end);
+        if (!Send()) {
+          schema_pending_ = true;
+          break;
+        }
+      }
+      ClearEvents();
+    }
+
+    unsigned long GetSentCount()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return sent_count_;
+    }
+
+    // 没有接收端或接收端来不及读取而丢弃的消息数
+    unsigned long GetDroppedCount()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return dropped_count_;
+    }
+
+  private:
+    struct NodeRecord
+    {
+      // 为空表示编号未被使用；用weak_ptr，节点在注销前被释放时也只会被跳过
+      std::weak_ptr<BehaviorNode> node_ptr;
+      // 父节点编号+1，0表示根节点
+      uint32_t parent_id;
+    };
+
+    struct Chunk
+    {
+      size_t begin;
+      size_t end;
+      uint32_t count;
+    };
+
+    void Register(const BehaviorNode::Ptr &node_ptr, uint32_t parent_id)
+    {
+      // TreeOptimizer合并的叶子节点在树中出现多次，只在第一次出现的位置分配编号
+      if (node_ptr->GetStateListener() == this) {
+        return;
+      }
+      uint32_t node_id;
+      if (free_ids_.empty()) {
+        node_id = nodes_.size();
+        nodes_.push_back(NodeRecord{node_ptr, parent_id});
+      } else {
+        node_id = free_ids_.back();
+        free_ids_.pop_back();
+        nodes_.at(node_id) = NodeRecord{node_ptr, parent_id};
+      }
+      node_ptr->SetStateListener(this, node_id);
+
+      std::vector<BehaviorNode::Ptr> children;
+      GetChildren(node_ptr, children);
+      for (auto &children_node_ptr : children) {
+        Register(children_node_ptr, node_id + 1);
+      }
+    }
+
+    void Unregister(const BehaviorNode::Ptr &node_ptr)
+    {
+      if (node_ptr->GetStateListener() != this) {
+        return;
+      }
+      nodes_.at(node_ptr->GetNodeId()).node_ptr.reset();
+      released_ids_.push_back(node_ptr->GetNodeId());
+      node_ptr->SetStateListener(nullptr, 0);
+
+      std::vector<BehaviorNode::Ptr> children;
+      GetChildren(node_ptr, children);
+      for (auto &children_node_ptr : children) {
+        Unregister(children_node_ptr);
+      }
+    }
+
+    // 固定的子节点加上运行中创建的子树
+    static void GetChildren(const BehaviorNode::Ptr &node_ptr, std::vector<BehaviorNode::Ptr> &children)
+    {
+      auto composite_node_ptr = std::dynamic_pointer_cast<CompositeNode>(node_ptr);
+      if (composite_node_ptr) {
+        children = composite_node_ptr->GetChildren();
+      } else if (node_ptr->GetChild() != nullptr) {
+        children.push_back(node_ptr->GetChild());
+      }
+      node_ptr->GetDynamicChildren(children);
+    }
+
+    void Clear()
+    {
+      for (auto &record : nodes_) {
+        auto node_ptr = record.node_ptr.lock();
+        if (node_ptr) {
+          node_ptr->SetStateListener(nullptr, 0);
+        }
+      }
+      nodes_.clear();
+      free_ids_.clear();
+      released_ids_.clear();
+      ClearEvents();
+    }
+
+    void ClearEvents()
+    {
+      events_.clear();
+      chunks_.clear();
+      chunk_begin_ = 0;
+      event_count_ = 0;
+    }
+
+    void BeginMessage(StateMessageType type)
+    {
+      message_.clear();
+      message_.push_back((uint8_t)type);
+      StateStream::PutVarint(message_, tree_id_);
+      StateStream::PutVarint(message_, epoch_);
+      StateStream::PutVarint(message_, sequence_++);
+    }
+
+    bool SendSchema()
+    {
+      epoch_++;
+      uint32_t node_count = 0;
+      for (auto &record : nodes_) {
+        if (!record.node_ptr.expired()) {
+          node_count++;
+        }
+      }
+      BeginMessage(StateMessageType::SCHEMA_BEGIN);
+      StateStream::PutVarint(message_, node_count);
+      if (!Send()) {
+        return false;
+      }
+
+      // 节点记录先写入records_，按MAX_MESSAGE_SIZE分条发送
+      unsigned int count = 0;
+      records_.clear();
+      for (uint32_t node_id = 0; node_id < nodes_.size(); node_id++)
+      {
+        auto node_ptr = nodes_.at(node_id).node_ptr.lock();
+        if (!node_ptr) {
+          continue;
+        }
+        // 名字过长时截断，保证单条记录不超过预留的长度
+        std::string name = node_ptr->GetName().substr(0, 255);
+        StateStream::PutVarint(records_, node_id);
+        StateStream::PutVarint(records_, nodes_.at(node_id).parent_id);
+        records_.push_back((uint8_t)node_ptr->GetBehaviorType());
+        records_.push_back((uint8_t)node_ptr->GetBehaviorState());
+        StateStream::PutVarint(records_, name.size());
+        records_.insert(records_.end(), name.begin(), name.end());
+        count++;
+        if (records_.size() >= StateStream::MAX_MESSAGE_SIZE - 32 - 256 && !SendRecords(count)) {
+          return false;
+        }
+      }
+      return count == 0 || SendRecords(count);
+    }
+
+    bool SendRecords(unsigned int &count)
+    {
+      BeginMessage(StateMessageType::SCHEMA_NODES);
+      StateStream::PutVarint(message_, count);
+      message_.insert(message_.end(), records_.begin(), records_.end());
+      records_.clear();
+      count = 0;
+      return Send();
+    }
+
+    // 非阻塞发送，失败时丢弃并返回false
+    bool Send()
+    {
+      ssize_t size = sendto(fd_, message_.data(), message_.size(), MSG_DONTWAIT,
+                            (const struct sockaddr*)&address_, sizeof(address_));
+      if (size < 0) {
+        dropped_count_++;
+        return false;
+      }
+      sent_count_++;
+      return true;
+    }
+
+    int fd_;
+    struct sockaddr_un address_;
+    uint32_t tree_id_;
+    uint32_t epoch_;
+    uint32_t sequence_;
+    // 遍历可能在多个线程上进行（ForEachNode），状态变化的记录需要加锁
+    std::mutex mutex_;
+    // 下标为节点编号
+    std::vector<NodeRecord> nodes_;
+    std::vector<uint32_t> free_ids_;
+    std::vector<uint32_t> released_ids_;
+    // 本帧的状态变化，超出单条消息长度的部分记录在chunks_中
+    std::vector<uint8_t> events_;
+    std::vector<Chunk> chunks_;
+    size_t chunk_begin_;
+    uint32_t event_count_;
+    std::vector<uint8_t> message_;
+    std::vector<uint8_t> records_;
+    bool schema_pending_;
+    unsigned long sent_count_;
+    unsigned long dropped_count_;
+};
+
+#endif
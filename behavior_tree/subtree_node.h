@@ -0,0 +1,219 @@
+#ifndef SUBTREE_NODE_H
+#define SUBTREE_NODE_H
+
+#include<behavior_node.h>
+#include<atomic>
+#include<deque>
+#include<mutex>
+
+/**
+ * @brief 子树定义，多个智能体共享，按需为每个智能体创建子树实例
+ */
+class SubtreeDefinition
+{
+  public:
+    typedef std::shared_ptr<SubtreeDefinition> Ptr;
+    typedef std::function<BehaviorNode::Ptr(const BlackBoard::Ptr &blackboard_ptr)> SubtreeFunction;
+
+    SubtreeDefinition(std::string name, SubtreeFunction subtree_function) :
+      name_(name),
+      subtree_function_(subtree_function){}
+
+    BehaviorNode::Ptr Instantiate(const BlackBoard::Ptr &blackboard_ptr)
+    {
+      return subtree_function_(blackboard_ptr);
+    }
+
+    std::string GetName()
+    {
+      return name_;
+    }
+
+  private:
+    std::string name_;
+    SubtreeFunction subtree_function_;
+};
+
+class SubtreeNode;
+
+/**
+ * @brief 回收空闲子树实例
+ * @details 子树结束或被终止后登记为空闲，空闲超过idle_timeout_仍未再次进入时释放其实例。
+ * 空闲时间按登记顺序递增，Sweep只需要检查队首，代价与到期的子树数量相关。
+ * 子树可能在ForEachNode的工作线程上进入、结束，登记与计数因此是线程安全的；
+ * Sweep释放子树实例，只能在遍历之外调用。
+ */
+class SubtreeEvictor
+{
+  public:
+    typedef std::shared_ptr<SubtreeEvictor> Ptr;
+
+    SubtreeEvictor(std::chrono::milliseconds idle_timeout) :
+      idle_timeout_(idle_timeout),
+      instance_count_(0){}
+
+    inline void MarkIdle(const std::shared_ptr<SubtreeNode> &subtree_node_ptr, unsigned int generation,
+                         std::chrono::steady_clock::time_point now);
+
+    // 释放空闲超时的子树实例，由BehaviorTree::Tick在每次遍历后调用
+    inline void Sweep(std::chrono::steady_clock::time_point now);
+
+    // 当前存在的子树实例数
+    unsigned int GetInstanceCount()
+    {
+      return instance_count_;
+    }
+
+  private:
+    friend class SubtreeNode;
+
+    struct IdleEntry
+    {
+      std::weak_ptr<SubtreeNode> subtree_node_ptr;
+      // 登记时子树的进入次数，之后再次进入过则该记录失效
+      unsigned int generation;
+      std::chrono::steady_clock::time_point idle_time;
+    };
+
+    std::chrono::milliseconds idle_timeout_;
+    std::atomic<unsigned int> instance_count_;
+    // 保护idle_entries_
+    std::mutex mutex_;
+    std::deque<IdleEntry> idle_entries_;
+};
+
+/**
+ * @brief 子树引用节点：首次进入时才从共享定义创建子树实例，空闲超时后由SubtreeEvictor释放
+ * Run/Reset的语义与直接挂载子树相同，内存占用只与实际在用的分支有关
+ */
+class SubtreeNode : public BehaviorNode
+{
+  public:
+    SubtreeNode(std::string name, const BlackBoard::Ptr &blackboard_ptr, const SubtreeDefinition::Ptr &definition,
+                const SubtreeEvictor::Ptr &evictor = nullptr) :
+      BehaviorNode::BehaviorNode(name, BehaviorType::SUBTREE, blackboard_ptr),
+      definition_(definition),
+      evictor_(evictor),
+      generation_(0){}
+
+    virtual ~SubtreeNode()
+    {
+      if (child_node_ptr_ && evictor_) {
+        evictor_->instance_count_--;
+      }
+    }
+
+    // 未实例化时为空
+    virtual BehaviorNode::Ptr GetChild()
+    {
+      return child_node_ptr_;
+    }
+
+    // 释放子树实例，运行中的子树不会被释放
+    bool Evict(unsigned int generation)
+    {
+      if (generation != generation_ || child_node_ptr_ == nullptr
+          || child_node_ptr_->GetBehaviorState() == BehaviorState::RUNNING) {
+        return false;
+      }
+      if (state_listener_ != nullptr) {
+        state_listener_->OnSubtreeDetached(child_node_ptr_);
+      }
+      child_node_ptr_ = nullptr;
+      if (evictor_) {
+        evictor_->instance_count_--;
+      }
+      return true;
+    }
+
+  protected:
+    virtual void OnInitialize()
+    {
+      generation_++;
+      if (child_node_ptr_ == nullptr)
+      {
+        child_node_ptr_ = definition_->Instantiate(blackboard_ptr_);
+        child_node_ptr_->SetParent(shared_from_this());
+        if (evictor_) {
+          evictor_->instance_count_++;
+        }
+        if (state_listener_ != nullptr) {
+          state_listener_->OnSubtreeAttached(shared_from_this(), child_node_ptr_);
+        }
+      }
+    }
+
+    virtual BehaviorState Update()
+    {
+      return child_node_ptr_->Run();
+    }
+
+    virtual void OnTerminate(BehaviorState state)
+    {
+      switch (state){
+        case BehaviorState::IDLE:
+          ResetRunning(child_node_ptr_);
+          break;
+        case BehaviorState::SUCCESS:
+          break;
+        case BehaviorState::FAILURE:
+          break;
+        default:
+          return;
+      }
+      if (evictor_) {
+        evictor_->MarkIdle(std::static_pointer_cast<SubtreeNode>(shared_from_this()), generation_, blackboard_ptr_->now);
+      }
+    }
+
+    // 定义与回收器都相同时直接接管旧节点的子树实例，子树中的节点连同其运行状态原样保留
+    virtual bool AdoptState(const BehaviorNode::Ptr &old_node_ptr)
+    {
+      auto old_subtree_node_ptr = std::dynamic_pointer_cast<SubtreeNode>(old_node_ptr);
+      if (!old_subtree_node_ptr || old_subtree_node_ptr->definition_ != definition_
+          || old_subtree_node_ptr->evictor_ != evictor_ || old_subtree_node_ptr->child_node_ptr_ == nullptr) {
+        return false;
+      }
+      child_node_ptr_ = old_subtree_node_ptr->child_node_ptr_;
+      child_node_ptr_->SetParent(shared_from_this());
+      old_subtree_node_ptr->child_node_ptr_ = nullptr;
+      generation_ = old_subtree_node_ptr->generation_;
+      return true;
+    }
+
+    SubtreeDefinition::Ptr definition_;
+    SubtreeEvictor::Ptr evictor_;
+    BehaviorNode::Ptr child_node_ptr_;
+    // 进入次数
+    unsigned int generation_;
+};
+
+void SubtreeEvictor::MarkIdle(const std::shared_ptr<SubtreeNode> &subtree_node_ptr, unsigned int generation,
+                              std::chrono::steady_clock::time_point now)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  idle_entries_.push_back(IdleEntry{subtree_node_ptr, generation, now});
+}
+
+void SubtreeEvictor::Sweep(std::chrono::steady_clock::time_point now)
+{
+  // 释放子树实例（析构节点、通知StatePublisher）时不持有锁
+  std::vector<IdleEntry> expired_entries;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!idle_entries_.empty() && now - idle_entries_.front().idle_time >= idle_timeout_)
+    {
+      expired_entries.push_back(idle_entries_.front());
+      idle_entries_.pop_front();
+    }
+  }
+  for (auto &entry : expired_entries)
+  {
+    auto subtree_node_ptr = entry.subtree_node_ptr.lock();
+    if (subtree_node_ptr) {
+      subtree_node_ptr->Evict(entry.generation);
+    }
+  }
+}
+
+#endif
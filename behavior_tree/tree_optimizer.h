@@ -0,0 +1,320 @@
+#ifndef TREE_OPTIMIZER_H
+#define TREE_OPTIMIZER_H
+
+#include<behavior_node.h>
+#include<map>
+#include<set>
+#include<typeinfo>
+
+// 优化结果统计
+struct OptimizeReport
+{
+  unsigned int node_count_before = 0;
+  unsigned int node_count_after = 0;
+  unsigned int depth_before = 0;
+  unsigned int depth_after = 0;
+  // 被折叠的单子节点组合节点
+  unsigned int folded_composites = 0;
+  // 被展开到父节点中的同类组合节点
+  unsigned int flattened_composites = 0;
+  // 被折叠的AbortType::NONE条件节点
+  unsigned int folded_guards = 0;
+  // 被合并的叶子节点
+  unsigned int merged_leaves = 0;
+  // 校验错误，不为空时树未被修改
+  std::vector<std::string> errors;
+
+  void Info()
+  {
+    if (!errors.empty()) {
+      for (auto &error : errors) {
+        std::cout << "tree invalid: " << error << std::endl;
+      }
+      return;
+    }
+    std::cout << "nodes: " << node_count_before << " -> " << node_count_after
+              << " depth: " << depth_before << " -> " << depth_after
+              << " (folded " << folded_composites << " composites, flattened " << flattened_composites
+              << ", folded " << folded_guards << " guards, merged " << merged_leaves << " leaves)" << std::endl;
+  }
+};
+
+/**
+ * @brief 行为树在首次遍历前的校验与优化
+ * @details 校验：条件节点没有子节点、组合节点没有子节点、并行节点的threshold_大于子节点数
+ * （会使children_node_ptr_.size()-threshold_下溢）以及树中存在环，均视为非法。
+ * 优化（不改变行为）：
+ *   1. 折叠只有一个子节点的选择、序列节点，以及threshold_不大于1的单子节点并行节点
+ *   2. 把序列节点中的序列子节点、选择节点中的选择子节点展开到父节点中
+ *   3. 合并GetConfigKey()相同的叶子节点，它们的最近公共祖先不能是并行节点（否则可能同时运行）；
+ *      父节点为LOW_PRIORITY/BOTH条件节点的叶子节点不参与合并，该条件节点在低优先级分支运行时被重新评估，
+ *      评估失败会复位子节点，共用时会误复位正在别处运行的同一节点
+ * 终止类型为LOW_PRIORITY/BOTH的条件节点只对其父选择节点生效，移动它会改变终止范围，因此相关的折叠与展开都会跳过。
+ * AbortType::NONE的条件节点在子节点未运行时仍会检查准入条件，折叠它会改变行为，
+ * 只有按其注释中的调试用途（准入条件失效）使用时才应打开fold_none_guards。
+ */
+class TreeOptimizer
+{
+  public:
+    TreeOptimizer(bool fold_none_guards = false) :
+      fold_none_guards_(fold_none_guards){}
+
+    // 校验树结构，非法时返回false并记录错误信息
+    bool Validate(const BehaviorNode::Ptr &root_node, std::vector<std::string> &errors)
+    {
+      std::set<BehaviorNode*> path;
+      ValidateNode(root_node, path, errors);
+      return errors.empty();
+    }
+
+    // 校验并优化树，返回新的根节点；校验失败时返回nullptr，错误信息见report.errors
+    BehaviorNode::Ptr Optimize(const BehaviorNode::Ptr &root_node, OptimizeReport &report)
+    {
+      if (!Validate(root_node, report.errors)) {
+        return nullptr;
+      }
+      report.node_count_before = CountNodes(root_node);
+      report.depth_before = Depth(root_node);
+
+      BehaviorNode::Ptr new_root_node = OptimizeNode(root_node, report);
+      std::map<std::string, std::vector<std::vector<BehaviorNode*>>> leaves;
+      std::vector<BehaviorNode*> path;
+      MergeLeaves(new_root_node, nullptr, 0, path, leaves, report);
+      new_root_node->SetParent(nullptr);
+
+      report.node_count_after = CountNodes(new_root_node);
+      report.depth_after = Depth(new_root_node);
+      return new_root_node;
+    }
+
+  private:
+    void ValidateNode(const BehaviorNode::Ptr &node_ptr, std::set<BehaviorNode*> &path, std::vector<std::string> &errors)
+    {
+      if (node_ptr == nullptr) {
+        errors.push_back("null node");
+        return;
+      }
+      if (!path.insert(node_ptr.get()).second) {
+        errors.push_back(node_ptr->GetName() + ": cycle detected");
+        return;
+      }
+
+      auto decorator_node_ptr = std::dynamic_pointer_cast<DecoratorNode>(node_ptr);
+      auto composite_node_ptr = std::dynamic_pointer_cast<CompositeNode>(node_ptr);
+      if (decorator_node_ptr)
+      {
+        if (decorator_node_ptr->GetChild() == nullptr) {
+          errors.push_back(node_ptr->GetName() + ": decorator without child");
+        } else {
+          ValidateNode(decorator_node_ptr->GetChild(), path, errors);
+        }
+      }
+      else if (composite_node_ptr)
+      {
+        auto &children = composite_node_ptr->GetChildren();
+        if (children.empty()) {
+          errors.push_back(node_ptr->GetName() + ": composite without children");
+        }
+        if (node_ptr->GetBehaviorType() == BehaviorType::PARALLEL
+            && std::dynamic_pointer_cast<ParallelNode>(node_ptr)->GetThreshold() > children.size()) {
+          errors.push_back(node_ptr->GetName() + ": threshold larger than children count");
+        }
+        for (auto &children_node_ptr : children) {
+          ValidateNode(children_node_ptr, path, errors);
+        }
+      }
+      path.erase(node_ptr.get());
+    }
+
+    // 后序优化，返回替换当前节点的节点
+    BehaviorNode::Ptr OptimizeNode(const BehaviorNode::Ptr &node_ptr, OptimizeReport &report)
+    {
+      auto decorator_node_ptr = std::dynamic_pointer_cast<DecoratorNode>(node_ptr);
+      if (decorator_node_ptr)
+      {
+        BehaviorNode::Ptr child_node_ptr = OptimizeNode(decorator_node_ptr->GetChild(), report);
+        if (child_node_ptr != decorator_node_ptr->GetChild()) {
+          decorator_node_ptr->SetChild(child_node_ptr);
+        }
+        if (fold_none_guards_ && node_ptr->GetBehaviorType() == BehaviorType::PRECONDITION
+            && std::dynamic_pointer_cast<PreconditionNode>(node_ptr)->GetAbortType() == AbortType::NONE
+            && !SelectorNode::NeedReevaluation(child_node_ptr))
+        {
+          report.folded_guards++;
+          return child_node_ptr;
+        }
+        return node_ptr;
+      }
+
+      auto composite_node_ptr = std::dynamic_pointer_cast<CompositeNode>(node_ptr);
+      if (!composite_node_ptr) {
+        return node_ptr;
+      }
+
+      auto &children = composite_node_ptr->GetChildren();
+      for (unsigned int index = 0; index < children.size(); index++)
+      {
+        BehaviorNode::Ptr child_node_ptr = OptimizeNode(children.at(index), report);
+        if (child_node_ptr != children.at(index)) {
+          composite_node_ptr->ReplaceChild(index, child_node_ptr);
+        }
+      }
+
+      Flatten(composite_node_ptr, report);
+
+      if (children.size() == 1 && !SelectorNode::NeedReevaluation(children.front())
+          && (node_ptr->GetBehaviorType() != BehaviorType::PARALLEL
+              || std::dynamic_pointer_cast<ParallelNode>(node_ptr)->GetThreshold() <= 1))
+      {
+        report.folded_composites++;
+        return children.front();
+      }
+      return node_ptr;
+    }
+
+    // 只展开确切类型为SequenceNode/SelectorNode的节点，派生类可能有额外的语义
+    void Flatten(const std::shared_ptr<CompositeNode> &composite_node_ptr, OptimizeReport &report)
+    {
+      const std::type_info &type = typeid(*composite_node_ptr);
+      if (type != typeid(SequenceNode) && type != typeid(SelectorNode)) {
+        return;
+      }
+
+      std::vector<BehaviorNode::Ptr> children;
+      bool flattened = false;
+      for (auto &children_node_ptr : composite_node_ptr->GetChildren())
+      {
+        auto inner_node_ptr = std::dynamic_pointer_cast<CompositeNode>(children_node_ptr);
+        if (inner_node_ptr && typeid(*inner_node_ptr) == type && !HasReevaluation(inner_node_ptr))
+        {
+          auto &inner_children = inner_node_ptr->GetChildren();
+          children.insert(children.end(), inner_children.begin(), inner_children.end());
+          report.flattened_composites++;
+          flattened = true;
+        }
+        else
+        {
+          children.push_back(children_node_ptr);
+        }
+      }
+
+      if (flattened)
+      {
+        composite_node_ptr->ClearChildren();
+        for (auto &children_node_ptr : children) {
+          composite_node_ptr->AddChildren(children_node_ptr);
+        }
+      }
+    }
+
+    bool HasReevaluation(const std::shared_ptr<CompositeNode> &composite_node_ptr)
+    {
+      for (auto &children_node_ptr : composite_node_ptr->GetChildren()) {
+        if (SelectorNode::NeedReevaluation(children_node_ptr)) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // 先序遍历，合并配置相同且不会同时运行的叶子节点
+    void MergeLeaves(const BehaviorNode::Ptr &node_ptr, const BehaviorNode::Ptr &parent_node_ptr, unsigned int index,
+                     std::vector<BehaviorNode*> &path,
+                     std::map<std::string, std::vector<std::vector<BehaviorNode*>>> &leaves,
+                     OptimizeReport &report)
+    {
+      auto decorator_node_ptr = std::dynamic_pointer_cast<DecoratorNode>(node_ptr);
+      auto composite_node_ptr = std::dynamic_pointer_cast<CompositeNode>(node_ptr);
+      if (decorator_node_ptr || composite_node_ptr)
+      {
+        path.push_back(node_ptr.get());
+        if (decorator_node_ptr) {
+          MergeLeaves(decorator_node_ptr->GetChild(), node_ptr, 0, path, leaves, report);
+        } else {
+          auto &children = composite_node_ptr->GetChildren();
+          for (unsigned int children_index = 0; children_index < children.size(); children_index++) {
+            MergeLeaves(children.at(children_index), node_ptr, children_index, path, leaves, report);
+          }
+        }
+        path.pop_back();
+        return;
+      }
+
+      std::string key = node_ptr->GetConfigKey();
+      if (key.empty() || parent_node_ptr == nullptr || SelectorNode::NeedReevaluation(parent_node_ptr)) {
+        return;
+      }
+
+      // 记录每个出现位置的祖先路径，路径的最后一个元素是叶子节点本身
+      auto &occurrences = leaves[key];
+      std::vector<BehaviorNode*> leaf_path(path);
+      leaf_path.push_back(node_ptr.get());
+      if (occurrences.empty() || node_ptr.get() == occurrences.front().back()) {
+        occurrences.push_back(leaf_path);
+        return;
+      }
+      for (auto &occurrence : occurrences) {
+        if (CommonAncestor(occurrence, leaf_path)->GetBehaviorType() == BehaviorType::PARALLEL) {
+          return;
+        }
+      }
+
+      BehaviorNode::Ptr shared_node_ptr = occurrences.front().back()->shared_from_this();
+      auto parent_decorator_node_ptr = std::dynamic_pointer_cast<DecoratorNode>(parent_node_ptr);
+      if (parent_decorator_node_ptr) {
+        parent_decorator_node_ptr->SetChild(shared_node_ptr);
+      } else {
+        std::dynamic_pointer_cast<CompositeNode>(parent_node_ptr)->ReplaceChild(index, shared_node_ptr);
+      }
+      leaf_path.back() = shared_node_ptr.get();
+      occurrences.push_back(leaf_path);
+      report.merged_leaves++;
+    }
+
+    BehaviorNode *CommonAncestor(const std::vector<BehaviorNode*> &a, const std::vector<BehaviorNode*> &b)
+    {
+      unsigned int depth = 0;
+      while (depth + 1 < a.size() && depth + 1 < b.size() && a.at(depth + 1) == b.at(depth + 1)) {
+        depth++;
+      }
+      return a.at(depth);
+    }
+
+    unsigned int CountNodes(const BehaviorNode::Ptr &root_node)
+    {
+      std::set<BehaviorNode*> nodes;
+      CollectNodes(root_node, nodes);
+      return nodes.size();
+    }
+
+    void CollectNodes(const BehaviorNode::Ptr &node_ptr, std::set<BehaviorNode*> &nodes)
+    {
+      nodes.insert(node_ptr.get());
+      auto composite_node_ptr = std::dynamic_pointer_cast<CompositeNode>(node_ptr);
+      if (composite_node_ptr) {
+        for (auto &children_node_ptr : composite_node_ptr->GetChildren()) {
+          CollectNodes(children_node_ptr, nodes);
+        }
+      } else if (node_ptr->GetChild() != nullptr) {
+        CollectNodes(node_ptr->GetChild(), nodes);
+      }
+    }
+
+    unsigned int Depth(const BehaviorNode::Ptr &node_ptr)
+    {
+      unsigned int depth = 0;
+      auto composite_node_ptr = std::dynamic_pointer_cast<CompositeNode>(node_ptr);
+      if (composite_node_ptr) {
+        for (auto &children_node_ptr : composite_node_ptr->GetChildren()) {
+          depth = std::max(depth, Depth(children_node_ptr));
+        }
+      } else if (node_ptr->GetChild() != nullptr) {
+        depth = Depth(node_ptr->GetChild());
+      }
+      return depth + 1;
+    }
+
+    bool fold_none_guards_;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include<algorithm>
+#include<atomic>
+#include<condition_variable>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+/**
+ * @brief 固定大小的工作线程池，用于按块并行处理数据
+ * @details 同一时刻只执行一个ParallelFor，调用线程也参与执行；
+ * 在块内（无论由工作线程还是调用线程执行）嵌套调用ParallelFor时直接在当前线程执行，避免死锁。
+ */
+class WorkerPool
+{
+  public:
+    typedef std::shared_ptr<WorkerPool> Ptr;
+
+    WorkerPool(unsigned int thread_count = std::thread::hardware_concurrency()) :
+      stop_(false), generation_(0), count_(0), chunk_size_(1), next_(0), working_(0)
+    {
+      for (unsigned int index = 0; index < thread_count; index++) {
+        threads_.emplace_back([this](){ WorkerLoop(); });
+      }
+    }
+
+    ~WorkerPool()
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+      }
+      start_condition_.notify_all();
+      for (auto &thread : threads_) {
+        thread.join();
+      }
+    }
+
+    // 把[0, count)按chunk_size分块，并行执行function(begin, end)，返回时所有块都已完成
+    void ParallelFor(size_t count, size_t chunk_size, const std::function<void(size_t, size_t)> &function)
+    {
+      if (chunk_size == 0) {
+        chunk_size = 1;
+      }
+      if (threads_.empty() || InWorker() || count <= chunk_size) {
+        for (size_t begin = 0; begin < count; begin += chunk_size) {
+          function(begin, std::min(count, begin + chunk_size));
+        }
+        return;
+      }
+
+      std::lock_guard<std::mutex> job_lock(job_mutex_);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        function_ = function;
+        count_ = count;
+        chunk_size_ = chunk_size;
+        next_.store(0);
+        working_ = threads_.size();
+        generation_++;
+      }
+      start_condition_.notify_all();
+
+      // 调用线程执行块时持有job_mutex_，块内的嵌套调用同样要直接在当前线程执行
+      InWorker() = true;
+      RunChunks();
+      InWorker() = false;
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_condition_.wait(lock, [this](){ return working_ == 0; });
+      function_ = nullptr;
+    }
+
+    unsigned int Size()
+    {
+      return threads_.size();
+    }
+
+  private:
+    static bool &InWorker()
+    {
+      static thread_local bool in_worker = false;
+      return in_worker;
+    }
+
+    void RunChunks()
+    {
+      while (true) {
+        size_t begin = next_.fetch_add(chunk_size_);
+        if (begin >= count_) {
+          return;
+        }
+        function_(begin, std::min(count_, begin + chunk_size_));
+      }
+    }
+
+    void WorkerLoop()
+    {
+      InWorker() = true;
+      unsigned long generation = 0;
+      while (true)
+      {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          start_condition_.wait(lock, [&](){ return stop_ || generation_ != generation; });
+          if (stop_) {
+            return;
+          }
+          generation = generation_;
+        }
+
+        RunChunks();
+
+        {
+          std::lock_guard<std::mutex> lock(mutex_);
+          working_--;
+        }
+        done_condition_.notify_one();
+      }
+    }
+
+    std::vector<std::thread> threads_;
+    // 保证同一时刻只有一个ParallelFor
+    std::mutex job_mutex_;
+    std::mutex mutex_;
+    std::condition_variable start_condition_;
+    std::condition_variable done_condition_;
+    bool stop_;
+    unsigned long generation_;
+    std::function<void(size_t, size_t)> function_;
+    size_t count_;
+    size_t chunk_size_;
+    std::atomic<size_t> next_;
+    unsigned int working_;
+};
+
+#endif
@@ -1,6 +1,15 @@
 #ifndef BLACKBOARD_H
 #define BLACKBOARD_H
 
+#include<algorithm>
+#include<memory>
+#include<functional>
+#include<vector>
+#include<chrono>
+#include<string>
+#include<unordered_map>
+#include<shared_scope.h>
+
 enum class Position
 {
     HOME,
@@ -9,12 +18,27 @@ enum class Position
     SCHOOL
 };
 
+// 黑板数据项标识，用于通知订阅者哪一项数据发生了变化
+enum class BlackBoardKey
+{
+    POSITION,
+    DESTINATION,
+    ENERGY,
+    // 按名字存取的数据，包括共享作用域中的数据
+    VALUES
+};
+
+// 按名字存取的数据，既用于智能体本地作用域，也用于多棵行为树共享的小队、全局作用域
+typedef std::unordered_map<std::string, int> BlackBoardValues;
+typedef SharedScope<BlackBoardValues> BlackBoardScope;
+
 class BlackBoard
 {
     public:
         typedef std::shared_ptr<BlackBoard> Ptr;
+        typedef std::function<void(BlackBoardKey)> Observer;
         BlackBoard():
-            position_(Position::HOME), energy_(100){}
+            position_(Position::HOME), destination_(Position::HOME), energy_(100), importance_(1.0f){}
 
         bool isHome(){return position_ == Position::HOME;}
         bool isMine(){return position_ == Position::MINE;}
@@ -24,13 +48,96 @@ class BlackBoard
 
         bool isEnergyLow(){return energy_ <= 20;}
 
-        void setPosition(Position postion){position_ = postion;}
-        void setDestination(Position destination){destination_ = destination;}
+        Position getPosition(){return position_;}
+        Position getDestination(){return destination_;}
+        unsigned int getEnergy(){return energy_;}
+
+        void setPosition(Position postion)
+        {
+            if (position_ == postion) return;
+            position_ = postion;
+            Notify(BlackBoardKey::POSITION);
+        }
+        void setDestination(Position destination)
+        {
+            if (destination_ == destination) return;
+            destination_ = destination;
+            Notify(BlackBoardKey::DESTINATION);
+        }
         void adjustEnergy(int v)
         {
+            unsigned int energy = energy_;
             energy_ += v;
             if (energy_ > 100) energy_ = 100;
             if (energy_ < 0) energy_ = 0;
+            if (energy_ != energy) Notify(BlackBoardKey::ENERGY);
+        }
+
+        // 重要程度，用于多智能体调度时决定遍历频率，越大越频繁
+        float getImportance(){return importance_;}
+        void setImportance(float importance){importance_ = importance;}
+
+        // 分层查找：先查本地作用域，再按添加顺序查找共享作用域（如小队、全局），找到返回true
+        bool getValue(const std::string &key, int &value)
+        {
+            auto iter = values_.find(key);
+            if (iter != values_.end()) {
+                value = iter->second;
+                return true;
+            }
+            for (auto &scope : scopes_) {
+                auto values = scope->Read();
+                auto scope_iter = values->find(key);
+                if (scope_iter != values->end()) {
+                    value = scope_iter->second;
+                    return true;
+                }
+            }
+            return false;
+        }
+        // 只写本地作用域，共享作用域通过BlackBoardScope::Update发布新版本
+        void setValue(const std::string &key, int value)
+        {
+            auto iter = values_.find(key);
+            if (iter != values_.end() && iter->second == value) return;
+            values_[key] = value;
+            Notify(BlackBoardKey::VALUES);
+        }
+        void addScope(const BlackBoardScope::Ptr &scope)
+        {
+            scopes_.push_back(scope);
+            scope_versions_.push_back(scope->GetVersion());
+            Notify(BlackBoardKey::VALUES);
+        }
+
+        // 共享作用域由其他智能体、其他线程发布新版本，不能在发布者的线程上通知本黑板的订阅者，
+        // 由BehaviorTree::Tick在每次遍历前检查版本，有作用域更新时通知一次
+        void pollScopes()
+        {
+            bool changed = false;
+            for (unsigned int index = 0; index < scopes_.size(); index++) {
+                uint64_t version = scopes_.at(index)->GetVersion();
+                if (version != scope_versions_.at(index)) {
+                    scope_versions_.at(index) = version;
+                    changed = true;
+                }
+            }
+            if (changed) Notify(BlackBoardKey::VALUES);
+        }
+
+        // 订阅数据变化，数据实际改变时才会通知
+        // 条件节点可以据此只在输入变化时重新评估，而不是每帧都评估一遍
+        // 返回的编号用于取消订阅，订阅者先于黑板释放时必须取消，否则会一直留在通知列表中
+        unsigned int Subscribe(const Observer &observer)
+        {
+            observers_.push_back(std::make_pair(++subscription_count_, observer));
+            return subscription_count_;
+        }
+        void Unsubscribe(unsigned int subscription)
+        {
+            observers_.erase(std::remove_if(observers_.begin(), observers_.end(),
+                [subscription](const std::pair<unsigned int, Observer> &observer){return observer.first == subscription;}),
+                observers_.end());
         }
 
         void Info()
@@ -40,6 +147,13 @@ class BlackBoard
         }
 
         unsigned int frame = 0;
+        // 本次遍历开始的时间，由BehaviorTree在每次遍历前设置
+        // 时间相关的动作应以它计时，遍历频率降低时仍按真实经过的时间完成
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        // 距离上一次遍历经过的时间
+        std::chrono::milliseconds tick_delta = std::chrono::milliseconds(0);
+        // 本树开始过的遍历次数，由BehaviorTree在每次遍历前加1；按遍历次数计数的节点（如ThrottleNode）以它为准
+        uint64_t tick = 0;
 
     private:
         // 位置
@@ -47,7 +161,19 @@ class BlackBoard
         Position destination_;
         // 精力值0~100
         unsigned int energy_;
-        
+        float importance_;
+
+        std::vector<std::pair<unsigned int, Observer>> observers_;
+        unsigned int subscription_count_ = 0;
+        BlackBoardValues values_;
+        std::vector<BlackBoardScope::Ptr> scopes_;
+        // 各共享作用域上一次检查时的版本
+        std::vector<uint64_t> scope_versions_;
+
+        void Notify(BlackBoardKey key)
+        {
+            for (auto &observer : observers_) observer.second(key);
+        }
 };
 
 #endif
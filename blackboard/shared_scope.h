@@ -0,0 +1,219 @@
+#ifndef SHARED_SCOPE_H
+#define SHARED_SCOPE_H
+
+#include<atomic>
+#include<cstdint>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+/**
+ * @brief 基于纪元的内存回收（epoch-based reclamation）
+ * @details 每个读线程占用一个槽位，进入读临界区时登记当前全局纪元，离开时清零。
+ * 写者替换数据后把旧版本连同当时的纪元放入待回收列表，只有当所有正在读的线程登记的纪元
+ * 都比它新时才释放，读者因此不需要任何锁。
+ */
+class EpochDomain
+{
+  public:
+    static const unsigned int MAX_READERS = 1024;
+
+    static EpochDomain &Instance()
+    {
+      static EpochDomain domain;
+      return domain;
+    }
+
+    void Enter()
+    {
+      Reader &reader = LocalReader();
+      if (reader.nesting++ == 0) {
+        slots_[reader.slot].store(epoch_.load());
+      }
+    }
+
+    void Leave()
+    {
+      Reader &reader = LocalReader();
+      if (--reader.nesting == 0) {
+        slots_[reader.slot].store(0);
+      }
+    }
+
+    // 推进全局纪元，返回推进前的纪元
+    uint64_t Advance()
+    {
+      return epoch_.fetch_add(1);
+    }
+
+    // 正在读的线程中最旧的纪元，没有读者时返回UINT64_MAX
+    uint64_t OldestReader()
+    {
+      uint64_t oldest = UINT64_MAX;
+      for (unsigned int slot = 0; slot < MAX_READERS; slot++) {
+        uint64_t epoch = slots_[slot].load();
+        if (epoch != 0 && epoch < oldest) {
+          oldest = epoch;
+        }
+      }
+      return oldest;
+    }
+
+  private:
+    // 线程退出时归还槽位
+    struct Reader
+    {
+      Reader(EpochDomain &domain) : domain(domain), slot(domain.AcquireSlot()), nesting(0){}
+      ~Reader(){ domain.used_[slot].store(false); }
+      EpochDomain &domain;
+      unsigned int slot;
+      unsigned int nesting;
+    };
+
+    EpochDomain() : epoch_(1)
+    {
+      for (unsigned int slot = 0; slot < MAX_READERS; slot++) {
+        slots_[slot].store(0);
+        used_[slot].store(false);
+      }
+    }
+
+    Reader &LocalReader()
+    {
+      static thread_local Reader reader(*this);
+      return reader;
+    }
+
+    unsigned int AcquireSlot()
+    {
+      while (true) {
+        for (unsigned int slot = 0; slot < MAX_READERS; slot++) {
+          bool expected = false;
+          if (!used_[slot].load() && used_[slot].compare_exchange_strong(expected, true)) {
+            return slot;
+          }
+        }
+        // 读线程数超过MAX_READERS时等待其他线程退出
+        std::this_thread::yield();
+      }
+    }
+
+    std::atomic<uint64_t> epoch_;
+    std::atomic<uint64_t> slots_[MAX_READERS];
+    std::atomic<bool> used_[MAX_READERS];
+};
+
+/**
+ * @brief 多棵行为树共享的只读作用域（read-copy-update）
+ * @details 读者通过Read()无锁读取当前版本，读取期间该版本不会被释放；
+ * 写者之间互斥，复制当前版本、修改后原子地发布新版本，读者要么看到旧版本要么看到新版本。
+ * 适合读多写少的小队、全局状态。
+ */
+template<typename T>
+class SharedScope
+{
+  public:
+    typedef std::shared_ptr<SharedScope<T>> Ptr;
+
+    class ReadGuard
+    {
+      public:
+        ReadGuard(const T *value) : value_(value)
+        {
+        }
+
+        ReadGuard(ReadGuard &&other) : value_(other.value_)
+        {
+          other.value_ = nullptr;
+        }
+
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+
+        ~ReadGuard()
+        {
+          if (value_ != nullptr) {
+            EpochDomain::Instance().Leave();
+          }
+        }
+
+        const T &operator*() const { return *value_; }
+        const T *operator->() const { return value_; }
+
+      private:
+        const T *value_;
+    };
+
+    SharedScope(const T &value = T()) : current_(new T(value)), version_(0){}
+
+    ~SharedScope()
+    {
+      delete current_.load();
+      for (auto &retired : retired_) {
+        delete retired.value;
+      }
+    }
+
+    // 无锁读取当前版本，返回的ReadGuard存活期间版本有效
+    ReadGuard Read() const
+    {
+      EpochDomain::Instance().Enter();
+      return ReadGuard(current_.load());
+    }
+
+    // 复制当前版本，由function修改后发布
+    template<typename Function>
+    void Update(Function function)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      T *value = new T(*current_.load());
+      function(*value);
+      Retire(current_.exchange(value));
+      version_.fetch_add(1);
+    }
+
+    void Publish(const T &value)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Retire(current_.exchange(new T(value)));
+      version_.fetch_add(1);
+    }
+
+    // 每发布一个新版本加一，读者据此发现作用域已更新，而不必比较内容
+    uint64_t GetVersion() const
+    {
+      return version_.load();
+    }
+
+  private:
+    struct Retired
+    {
+      T *value;
+      uint64_t epoch;
+    };
+
+    void Retire(T *value)
+    {
+      EpochDomain &domain = EpochDomain::Instance();
+      retired_.push_back(Retired{value, domain.Advance()});
+      // 登记纪元比退役纪元新的读者一定读到的是新版本
+      uint64_t oldest = domain.OldestReader();
+      auto iter = retired_.begin();
+      while (iter != retired_.end()) {
+        if (iter->epoch < oldest) {
+          delete iter->value;
+          iter = retired_.erase(iter);
+        } else {
+          ++iter;
+        }
+      }
+    }
+
+    std::atomic<T*> current_;
+    std::atomic<uint64_t> version_;
+    std::mutex mutex_;
+    std::vector<Retired> retired_;
+};
+
+#endif
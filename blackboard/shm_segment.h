@@ -0,0 +1,309 @@
+#ifndef SHM_SEGMENT_H
+#define SHM_SEGMENT_H
+
+#include<atomic>
+#include<cerrno>
+#include<cstdint>
+#include<cstring>
+#include<iostream>
+#include<memory>
+#include<string>
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+#include<blackboard.h>
+
+// 不同进程通过同一块内存上的原子变量同步，必须是无锁实现
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "shared memory segment requires lock-free std::atomic<int>");
+
+// 数据块中各字段的位置，属于共享内存布局的一部分，只能在末尾追加
+enum class ShmField
+{
+    POSITION,
+    DESTINATION,
+    ENERGY,
+    FRAME       ///<本树的遍历次数（BlackBoard::tick）
+};
+
+/**
+ * @brief 顺序锁保护的数据块
+ * @details 只允许一个写者：写前后各把sequence加一，写入期间sequence为奇数；
+ * 读者在sequence为偶数且读取前后不变时才采用读到的数据，写者从不等待读者。
+ * 字段都是relaxed原子变量，读到一半被改写时也不会产生数据竞争，只会被sequence校验丢弃。
+ */
+struct ShmBlock
+{
+    static const unsigned int FIELD_COUNT = 8;
+
+    std::atomic<uint32_t> sequence;
+    std::atomic<int32_t> fields[FIELD_COUNT];
+
+    void Write(const int32_t (&values)[FIELD_COUNT])
+    {
+        uint32_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (unsigned int index = 0; index < FIELD_COUNT; index++) {
+            fields[index].store(values[index], std::memory_order_relaxed);
+        }
+        sequence.store(current + 2, std::memory_order_release);
+    }
+
+    // 读取一致的快照，写者一直在写（如写进程在写入中途退出）时重试max_retries次后返回false
+    bool Read(int32_t (&values)[FIELD_COUNT], uint32_t &read_sequence, unsigned int max_retries = 1024) const
+    {
+        for (unsigned int retry = 0; retry < max_retries; retry++)
+        {
+            uint32_t begin = sequence.load(std::memory_order_acquire);
+            if (begin & 1) {
+                continue;
+            }
+            for (unsigned int index = 0; index < FIELD_COUNT; index++) {
+                values[index] = fields[index].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == begin) {
+                read_sequence = begin;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/**
+ * @brief 每个智能体一个槽位：input由外部进程（仿真、感知）写入，output由决策进程写入
+ * 两个数据块的写者不同，各占一条缓存行，避免伪共享
+ */
+struct ShmSlot
+{
+    alignas(64) ShmBlock input;
+    alignas(64) ShmBlock output;
+};
+
+struct ShmHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_size;
+    uint32_t slot_count;
+    // 创建者初始化完成后置1，打开者据此判断布局已可用
+    std::atomic<uint32_t> ready;
+};
+
+/**
+ * @brief 命名的POSIX共享内存段，按固定布局存放一组智能体的黑板数据
+ * @details 布局为ShmHeader后接slot_count个ShmSlot，头部记录魔数、版本与槽位大小，
+ * 布局不兼容的进程打开时会失败。映射完成后的读写都是普通内存访问，不需要系统调用，也不需要复制。
+ * 创建者负责在析构时删除共享内存段的名字，已打开的进程不受影响。
+ */
+class ShmSegment
+{
+  public:
+    typedef std::shared_ptr<ShmSegment> Ptr;
+
+    static const uint32_t MAGIC = 0x42425348;
+    static const uint32_t VERSION = 1;
+
+    ~ShmSegment()
+    {
+      munmap(address_, size_);
+      if (owner_) {
+        shm_unlink(name_.c_str());
+      }
+    }
+
+    /**
+     * @brief 创建共享内存段，同名的段已存在时失败
+     * @param name 以/开头的名字，如"/westworld"
+     * @return 失败时返回nullptr
+     */
+    static Ptr Create(const std::string &name, unsigned int slot_count)
+    {
+      int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+      if (fd < 0) {
+        std::cerr << "shm_open " << name << " failed: " << std::strerror(errno) << std::endl;
+        return nullptr;
+      }
+      size_t size = sizeof(ShmHeader) + HeaderPadding() + slot_count * sizeof(ShmSlot);
+      // ftruncate扩展出的内存全部为0，即所有sequence从0开始
+      if (ftruncate(fd, size) != 0) {
+        std::cerr << "ftruncate " << name << " failed: " << std::strerror(errno) << std::endl;
+        close(fd);
+        shm_unlink(name.c_str());
+        return nullptr;
+      }
+      Ptr segment = Map(name, fd, size, true);
+      if (segment == nullptr) {
+        shm_unlink(name.c_str());
+        return nullptr;
+      }
+      ShmHeader *header = segment->Header();
+      header->magic = MAGIC;
+      header->version = VERSION;
+      header->slot_size = sizeof(ShmSlot);
+      header->slot_count = slot_count;
+      header->ready.store(1, std::memory_order_release);
+      return segment;
+    }
+
+    // 打开已存在的共享内存段并校验布局，失败时返回nullptr
+    static Ptr Open(const std::string &name)
+    {
+      int fd = shm_open(name.c_str(), O_RDWR, 0600);
+      if (fd < 0) {
+        std::cerr << "shm_open " << name << " failed: " << std::strerror(errno) << std::endl;
+        return nullptr;
+      }
+      struct stat status;
+      if (fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(ShmHeader)) {
+        std::cerr << "shm segment " << name << " is too small" << std::endl;
+        close(fd);
+        return nullptr;
+      }
+      Ptr segment = Map(name, fd, status.st_size, false);
+      if (segment == nullptr) {
+        return nullptr;
+      }
+      ShmHeader *header = segment->Header();
+      if (header->ready.load(std::memory_order_acquire) != 1 || header->magic != MAGIC) {
+        std::cerr << "shm segment " << name << " is not initialized" << std::endl;
+        return nullptr;
+      }
+      if (header->version != VERSION || header->slot_size != sizeof(ShmSlot)) {
+        std::cerr << "shm segment " << name << " layout mismatch: version " << header->version
+                  << ", slot size " << header->slot_size << std::endl;
+        return nullptr;
+      }
+      if (segment->size_ < sizeof(ShmHeader) + HeaderPadding() + header->slot_count * sizeof(ShmSlot)) {
+        std::cerr << "shm segment " << name << " is truncated" << std::endl;
+        return nullptr;
+      }
+      return segment;
+    }
+
+    unsigned int GetSlotCount()
+    {
+      return Header()->slot_count;
+    }
+
+    // 越界时返回nullptr
+    ShmSlot *GetSlot(unsigned int index)
+    {
+      if (index >= GetSlotCount()) {
+        return nullptr;
+      }
+      char *slots = static_cast<char*>(address_) + sizeof(ShmHeader) + HeaderPadding();
+      return reinterpret_cast<ShmSlot*>(slots) + index;
+    }
+
+    std::string GetName()
+    {
+      return name_;
+    }
+
+  private:
+    ShmSegment(const std::string &name, void *address, size_t size, bool owner) :
+      name_(name),
+      address_(address),
+      size_(size),
+      owner_(owner){}
+
+    // 槽位按缓存行对齐
+    static size_t HeaderPadding()
+    {
+      return (alignof(ShmSlot) - sizeof(ShmHeader) % alignof(ShmSlot)) % alignof(ShmSlot);
+    }
+
+    static Ptr Map(const std::string &name, int fd, size_t size, bool owner)
+    {
+      void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      // 映射建立后不再需要文件描述符
+      close(fd);
+      if (address == MAP_FAILED) {
+        std::cerr << "mmap " << name << " failed: " << std::strerror(errno) << std::endl;
+        return nullptr;
+      }
+      return Ptr(new ShmSegment(name, address, size, owner));
+    }
+
+    ShmHeader *Header()
+    {
+      return static_cast<ShmHeader*>(address_);
+    }
+
+    std::string name_;
+    void *address_;
+    size_t size_;
+    bool owner_;
+};
+
+/**
+ * @brief 把黑板绑定到共享内存段中的一个槽位
+ * @details Pull在遍历前读取外部进程写入的输入，只有输入的sequence变化时才写入黑板，
+ * 避免旧的输入覆盖动作节点对黑板的修改；Push在遍历后发布决策结果。见BehaviorTree::SetShmBinding
+ */
+class ShmBinding
+{
+  public:
+    typedef std::shared_ptr<ShmBinding> Ptr;
+
+    ShmBinding(const ShmSegment::Ptr &segment, unsigned int slot_index) :
+      segment_(segment),
+      slot_ptr_(segment ? segment->GetSlot(slot_index) : nullptr),
+      input_sequence_(0){}
+
+    // 槽位不存在时绑定无效
+    bool IsValid()
+    {
+      return slot_ptr_ != nullptr;
+    }
+
+    // 有新的输入并已写入黑板时返回true；输入超出取值范围时整条丢弃并返回false
+    bool Pull(BlackBoard &blackboard)
+    {
+      if (slot_ptr_ == nullptr) {
+        return false;
+      }
+      int32_t values[ShmBlock::FIELD_COUNT];
+      uint32_t sequence;
+      // sequence为0表示外部进程还没有写过输入
+      if (!slot_ptr_->input.Read(values, sequence) || sequence == 0 || sequence == input_sequence_) {
+        return false;
+      }
+      input_sequence_ = sequence;
+      // 共享内存可被其他进程任意写入，不能直接转换为枚举或写入黑板
+      int32_t position = values[(int)ShmField::POSITION];
+      int32_t energy = values[(int)ShmField::ENERGY];
+      if (position < (int32_t)Position::HOME || position > (int32_t)Position::SCHOOL || energy < 0 || energy > 100) {
+        std::cerr << "shm segment " << segment_->GetName() << " invalid input: position " << position
+                  << ", energy " << energy << std::endl;
+        return false;
+      }
+      blackboard.setPosition(static_cast<Position>(position));
+      blackboard.adjustEnergy(energy - (int)blackboard.getEnergy());
+      return true;
+    }
+
+    void Push(BlackBoard &blackboard)
+    {
+      if (slot_ptr_ == nullptr) {
+        return;
+      }
+      int32_t values[ShmBlock::FIELD_COUNT] = {0};
+      values[(int)ShmField::POSITION] = (int32_t)blackboard.getPosition();
+      values[(int)ShmField::DESTINATION] = (int32_t)blackboard.getDestination();
+      values[(int)ShmField::ENERGY] = (int32_t)blackboard.getEnergy();
+      values[(int)ShmField::FRAME] = (int32_t)blackboard.tick;
+      slot_ptr_->output.Write(values);
+    }
+
+  private:
+    // 持有共享内存段，保证映射在绑定存活期间有效
+    ShmSegment::Ptr segment_;
+    ShmSlot *slot_ptr_;
+    uint32_t input_sequence_;
+};
+
+#endif
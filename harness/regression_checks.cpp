@@ -0,0 +1,1082 @@
+#include<lod_scheduler.h>
+#include<indexed_selector_node.h>
+#include<foreach_node.h>
+#include<subtree_node.h>
+#include<decorator_nodes.h>
+#include<changePositionAction.h>
+#include<map>
+#include<random>
+#include<set>
+
+/**
+ * 回归检查：覆盖容易写错的行为（终止语义、线程、生命周期），由ctest运行，任一检查失败时以非0退出。
+ *
+ * regression_checks [name]...
+ * 指定name时只运行指定的检查
+ */
+
+#define CHECK(condition) \
+    if (!(condition)) { \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+        return false; \
+    }
+
+// 每次Update按脚本写黑板，运行duration次后以固定结果结束
+class ScriptedAction : public ActionNode
+{
+public:
+    enum class Write
+    {
+        NONE,
+        ENERGY,
+        POSITION
+    };
+
+    ScriptedAction(std::string name, const BlackBoard::Ptr &blackboard_ptr, unsigned int duration, bool success,
+                   Write write, int argument):
+        ActionNode(name, blackboard_ptr),
+        duration_(duration),
+        ticks_(0),
+        success_(success),
+        write_(write),
+        argument_(argument){}
+
+    virtual ~ScriptedAction(){}
+
+private:
+    virtual void OnInitialize()
+    {
+        ticks_ = 0;
+    }
+
+    virtual BehaviorState Update()
+    {
+        switch (write_) {
+            case Write::ENERGY:
+                blackboard_ptr_->adjustEnergy(argument_);
+                break;
+            case Write::POSITION:
+                blackboard_ptr_->setPosition((Position)argument_);
+                break;
+            default:
+                break;
+        }
+        if (ticks_++ < duration_) {
+            return BehaviorState::RUNNING;
+        }
+        return success_ ? BehaviorState::SUCCESS : BehaviorState::FAILURE;
+    }
+
+    virtual void OnTerminate(BehaviorState)
+    {
+
+    }
+
+    unsigned int duration_;
+    unsigned int ticks_;
+    bool success_;
+    Write write_;
+    int argument_;
+};
+
+// 相同的种子生成结构相同的选择节点，动作节点按创建顺序记录在actions中
+template<typename Selector>
+std::shared_ptr<Selector> GenerateSelector(unsigned int seed, const BlackBoard::Ptr &blackboard_ptr,
+                                           std::vector<BehaviorNode::Ptr> &actions)
+{
+    static const AbortType abort_types[] = {AbortType::NONE, AbortType::SELF, AbortType::LOW_PRIORITY, AbortType::BOTH};
+    std::mt19937 random(seed);
+    auto uniform = [&random](int min, int max){return std::uniform_int_distribution<int>(min, max)(random);};
+    auto make_action = [&](){
+        auto action = std::make_shared<ScriptedAction>("action" + std::to_string(actions.size()), blackboard_ptr,
+            uniform(0, 2), uniform(0, 1) == 1, (ScriptedAction::Write)uniform(0, 2), uniform(-40, 40));
+        // 位置只有三个取值
+        if (uniform(0, 1) == 0) {
+            action = std::make_shared<ScriptedAction>("action" + std::to_string(actions.size()), blackboard_ptr,
+                uniform(0, 2), uniform(0, 1) == 1, ScriptedAction::Write::POSITION, uniform(0, 2));
+        }
+        actions.push_back(action);
+        return action;
+    };
+
+    auto selector = std::make_shared<Selector>("selector", blackboard_ptr);
+    unsigned int children_count = uniform(2, 8);
+    for (unsigned int index = 0; index < children_count; index++)
+    {
+        BehaviorNode::Ptr child;
+        if (uniform(0, 2) == 0) {
+            child = make_action();
+        } else {
+            auto sequence = std::make_shared<SequenceNode>("sequence" + std::to_string(index), blackboard_ptr);
+            sequence->AddChildren(make_action());
+            sequence->AddChildren(make_action());
+            child = sequence;
+        }
+        if (uniform(0, 3) != 0)
+        {
+            std::function<bool()> precondition_function;
+            int argument = uniform(0, 100);
+            if (uniform(0, 1) == 0) {
+                precondition_function = [blackboard_ptr, argument](){return (int)blackboard_ptr->getEnergy() > argument;};
+            } else {
+                precondition_function = [blackboard_ptr, argument](){return (int)blackboard_ptr->getPosition() == argument % 3;};
+            }
+            auto precondition_node = std::make_shared<PreconditionNode>("guard" + std::to_string(index),
+                abort_types[uniform(0, 3)], blackboard_ptr, precondition_function);
+            precondition_node->SetChild(child);
+            child = precondition_node;
+        }
+        selector->AddChildren(child);
+    }
+    return selector;
+}
+
+// IndexedSelectorNode与SelectorNode对同一棵随机树的返回值、动作节点状态逐帧一致，动作节点会改写条件依赖的黑板数据
+bool CheckIndexedSelectorEquivalence()
+{
+    for (unsigned int seed = 0; seed < 3000; seed++)
+    {
+        auto blackboard_ptr = std::make_shared<BlackBoard>();
+        auto indexed_blackboard_ptr = std::make_shared<BlackBoard>();
+        std::vector<BehaviorNode::Ptr> actions, indexed_actions;
+        auto selector = GenerateSelector<SelectorNode>(seed, blackboard_ptr, actions);
+        auto indexed_selector = GenerateSelector<IndexedSelectorNode>(seed, indexed_blackboard_ptr, indexed_actions);
+
+        std::mt19937 random(seed);
+        for (unsigned int frame = 0; frame < 20; frame++)
+        {
+            // 外部输入同样会改变条件
+            int energy = std::uniform_int_distribution<int>(-30, 30)(random);
+            blackboard_ptr->adjustEnergy(energy);
+            indexed_blackboard_ptr->adjustEnergy(energy);
+
+            BehaviorState state = selector->Run();
+            BehaviorState indexed_state = indexed_selector->Run();
+            if (state != indexed_state) {
+                std::cerr << "seed " << seed << " frame " << frame << ": selector states differ" << std::endl;
+                return false;
+            }
+            for (unsigned int index = 0; index < actions.size(); index++)
+            {
+                if (actions.at(index)->GetBehaviorState() != indexed_actions.at(index)->GetBehaviorState()) {
+                    std::cerr << "seed " << seed << " frame " << frame << ": " << actions.at(index)->GetName()
+                              << " states differ" << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// 记录被遍历的次数与OnTerminate收到的状态，每次遍历都以state结束
+class CountingAction : public ActionNode
+{
+public:
+    CountingAction(std::string name, const BlackBoard::Ptr &blackboard_ptr,
+                   BehaviorState state = BehaviorState::SUCCESS):
+        ActionNode(name, blackboard_ptr),
+        count_(0),
+        state_(state){}
+
+    virtual ~CountingAction(){}
+
+    unsigned int GetCount()
+    {
+        return count_;
+    }
+
+    const std::vector<BehaviorState> &GetTerminations()
+    {
+        return terminations_;
+    }
+
+private:
+    virtual void OnInitialize(){}
+
+    virtual BehaviorState Update()
+    {
+        count_++;
+        return state_;
+    }
+
+    virtual void OnTerminate(BehaviorState state)
+    {
+        terminations_.push_back(state);
+    }
+
+    unsigned int count_;
+    BehaviorState state_;
+    std::vector<BehaviorState> terminations_;
+};
+
+// 各级别按各自的周期遍历且每帧负载平稳；设置上限后从importance最低的智能体开始降级
+bool CheckLodScheduler()
+{
+    const float importances[] = {1.0f, 0.5f, 0.1f};
+    const unsigned int periods[] = {1, 4, 16};
+    LodScheduler scheduler(0, {1, 4, 16}, {0.8f, 0.3f, 0.0f});
+    std::vector<std::shared_ptr<CountingAction>> actions;
+    for (unsigned int id = 0; id < 48; id++)
+    {
+        auto blackboard_ptr = std::make_shared<BlackBoard>();
+        blackboard_ptr->setImportance(importances[id % 3]);
+        actions.push_back(std::make_shared<CountingAction>("count" + std::to_string(id), blackboard_ptr));
+        CHECK(scheduler.AddAgent(std::make_shared<BehaviorTree>(actions.back(), 0, blackboard_ptr)) == id);
+    }
+
+    // 16个智能体每帧、16个每4帧、16个每16帧遍历一次
+    for (unsigned int frame = 0; frame < 64; frame++)
+    {
+        scheduler.Step();
+        CHECK(scheduler.GetTicksLastFrame() == 16 + 4 + 1);
+    }
+    for (unsigned int id = 0; id < actions.size(); id++) {
+        CHECK(actions.at(id)->GetCount() == 64 / periods[id % 3]);
+    }
+
+    scheduler.SetMaxTicksPerFrame(10);
+    scheduler.Step();
+    CHECK(scheduler.GetLoad() <= 10);
+    for (unsigned int id = 0; id + 1 < actions.size(); id++) {
+        CHECK(importances[id % 3] < importances[(id + 1) % 3] || scheduler.GetLevel(id) <= scheduler.GetLevel(id + 1));
+    }
+    for (unsigned int frame = 0; frame < 64; frame++)
+    {
+        scheduler.Step();
+        CHECK(scheduler.GetTicksLastFrame() <= 10 + 1);
+    }
+    return true;
+}
+
+// 预算为0时每次遍历只运行一个子节点后在安全点停下，下一次遍历从停下的位置继续，已完成的子节点不会重复运行
+bool CheckBudgetedYield()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    const struct
+    {
+        std::shared_ptr<CompositeNode> root_node;
+        BehaviorState children_state;
+    } roots[] = {
+        {std::make_shared<SequenceNode>("sequence", blackboard_ptr), BehaviorState::SUCCESS},
+        {std::make_shared<SelectorNode>("selector", blackboard_ptr), BehaviorState::FAILURE},
+        {std::make_shared<IndexedSelectorNode>("indexed_selector", blackboard_ptr), BehaviorState::FAILURE},
+        {std::make_shared<ParallelNode>("parallel", blackboard_ptr, 3), BehaviorState::SUCCESS},
+    };
+    for (auto &root : roots)
+    {
+        std::vector<std::shared_ptr<CountingAction>> actions;
+        for (unsigned int index = 0; index < 3; index++)
+        {
+            actions.push_back(std::make_shared<CountingAction>("count" + std::to_string(index), blackboard_ptr,
+                root.children_state));
+            root.root_node->AddChildren(actions.back());
+        }
+        BehaviorTree tree(root.root_node, 0, blackboard_ptr);
+
+        for (unsigned int tick = 0; tick < actions.size(); tick++)
+        {
+            bool last = tick + 1 == actions.size();
+            CHECK(tree.Tick(std::chrono::microseconds(0)) == (last ? root.children_state : BehaviorState::RUNNING));
+            CHECK(tree.Preempted() == !last);
+            for (unsigned int index = 0; index < actions.size(); index++) {
+                CHECK(actions.at(index)->GetCount() == (index <= tick ? 1u : 0u));
+            }
+        }
+        // 不限时的遍历从头开始，一次运行全部子节点
+        CHECK(tree.Tick() == root.children_state);
+        CHECK(!tree.Preempted());
+        for (auto &action : actions) {
+            CHECK(action->GetCount() == 2);
+        }
+    }
+    return true;
+}
+
+// 并行节点被终止时只复位返回过RUNNING且尚未完成的子节点，复位后登记清空，重新进入时不会重复复位
+bool CheckParallelAbort()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    auto parallel = std::make_shared<ParallelNode>("parallel", blackboard_ptr, 2);
+    auto done = std::make_shared<CountingAction>("done", blackboard_ptr, BehaviorState::SUCCESS);
+    auto running = std::make_shared<CountingAction>("running", blackboard_ptr, BehaviorState::RUNNING);
+    parallel->AddChildren(done);
+    parallel->AddChildren(running);
+
+    for (unsigned int round = 1; round <= 2; round++)
+    {
+        CHECK(parallel->Run() == BehaviorState::RUNNING);
+        CHECK(done->GetBehaviorState() == BehaviorState::SUCCESS);
+        CHECK(running->GetBehaviorState() == BehaviorState::RUNNING);
+        parallel->Reset();
+        CHECK(parallel->GetBehaviorState() == BehaviorState::IDLE);
+        CHECK(running->GetBehaviorState() == BehaviorState::IDLE);
+        // 已完成的子节点只有正常结束时的一次OnTerminate
+        CHECK(done->GetTerminations() == std::vector<BehaviorState>(round, BehaviorState::SUCCESS));
+        CHECK(running->GetTerminations() == std::vector<BehaviorState>(round, BehaviorState::IDLE));
+        CHECK(done->GetCount() == round && running->GetCount() == round);
+    }
+    return true;
+}
+
+// 清空后重新添加的子节点不受原有条件登记的影响
+bool CheckIndexedSelectorClearChildren()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    auto indexed_selector = std::make_shared<IndexedSelectorNode>("selector", blackboard_ptr);
+    auto guard = std::make_shared<PreconditionNode>("guard", AbortType::BOTH, blackboard_ptr, [](){return true;});
+    guard->SetChild(std::make_shared<ScriptedAction>("failure", blackboard_ptr, 0, false, ScriptedAction::Write::NONE, 0));
+    indexed_selector->AddChildren(guard);
+    CHECK(indexed_selector->Run() == BehaviorState::FAILURE);
+
+    indexed_selector->ClearChildren();
+    CHECK(indexed_selector->GetChildren().empty());
+    CHECK(indexed_selector->GetChildIndex(guard) < 0);
+    auto success = std::make_shared<ScriptedAction>("success", blackboard_ptr, 0, true, ScriptedAction::Write::NONE, 0);
+    indexed_selector->AddChildren(success);
+    CHECK(indexed_selector->GetChildIndex(success) == 0);
+    CHECK(indexed_selector->Run() == BehaviorState::SUCCESS);
+    return true;
+}
+
+// 配置相同的实例行为完全一致，可以被优化器合并
+class KeyedAction : public ScriptedAction
+{
+public:
+    KeyedAction(std::string name, const BlackBoard::Ptr &blackboard_ptr, unsigned int duration, bool success,
+                Write write, int argument):
+        ScriptedAction(name, blackboard_ptr, duration, success, write, argument),
+        config_key_("KeyedAction:" + std::to_string(duration) + ":" + std::to_string(success) + ":"
+                    + std::to_string((int)write) + ":" + std::to_string(argument)){}
+
+    virtual ~KeyedAction(){}
+
+    virtual std::string GetConfigKey()
+    {
+        return config_key_;
+    }
+
+private:
+    std::string config_key_;
+};
+
+// 生成含有单子节点组合节点、同类嵌套组合节点与配置重复叶子节点的随机树，覆盖优化器的折叠、展开与合并
+BehaviorNode::Ptr GenerateOptimizableTree(std::mt19937 &random, const BlackBoard::Ptr &blackboard_ptr,
+                                          unsigned int depth, std::vector<BehaviorNode::Ptr> &nodes)
+{
+    static const AbortType abort_types[] = {AbortType::NONE, AbortType::SELF, AbortType::LOW_PRIORITY, AbortType::BOTH};
+    auto uniform = [&random](int min, int max){return std::uniform_int_distribution<int>(min, max)(random);};
+    std::string name = "n" + std::to_string(nodes.size());
+    if (depth == 0 || uniform(0, 3) == 0)
+    {
+        // 取值范围小，配置经常重复
+        bool write = uniform(0, 1) == 0;
+        nodes.push_back(std::make_shared<KeyedAction>(name, blackboard_ptr, uniform(0, 2), uniform(0, 1) == 1,
+            write ? ScriptedAction::Write::ENERGY : ScriptedAction::Write::NONE, write ? uniform(-1, 1) * 20 : 0));
+        return nodes.back();
+    }
+    if (uniform(0, 4) == 0)
+    {
+        int argument = uniform(0, 100);
+        auto precondition_node = std::make_shared<PreconditionNode>(name, abort_types[uniform(0, 3)], blackboard_ptr,
+            [blackboard_ptr, argument](){return (int)blackboard_ptr->getEnergy() > argument;});
+        nodes.push_back(precondition_node);
+        precondition_node->SetChild(GenerateOptimizableTree(random, blackboard_ptr, depth - 1, nodes));
+        return precondition_node;
+    }
+
+    unsigned int children_count = uniform(1, 3);
+    std::shared_ptr<CompositeNode> composite_node;
+    switch (uniform(0, 2)) {
+        case 0:
+            composite_node = std::make_shared<SelectorNode>(name, blackboard_ptr);
+            break;
+        case 1:
+            composite_node = std::make_shared<SequenceNode>(name, blackboard_ptr);
+            break;
+        default:
+            composite_node = std::make_shared<ParallelNode>(name, blackboard_ptr, uniform(1, children_count));
+            break;
+    }
+    nodes.push_back(composite_node);
+    for (unsigned int index = 0; index < children_count; index++) {
+        composite_node->AddChildren(GenerateOptimizableTree(random, blackboard_ptr, depth - 1, nodes));
+    }
+    return composite_node;
+}
+
+// 各配置正在运行的叶子节点数；合并后的叶子节点在树中出现多次，只计一次
+void CountRunningLeaves(const BehaviorNode::Ptr &root_node, std::map<std::string, unsigned int> &running_leaves)
+{
+    std::set<BehaviorNode*> visited;
+    std::vector<BehaviorNode::Ptr> nodes = {root_node};
+    while (!nodes.empty())
+    {
+        BehaviorNode::Ptr node_ptr = nodes.back();
+        nodes.pop_back();
+        if (!visited.insert(node_ptr.get()).second) {
+            continue;
+        }
+        auto composite_node_ptr = std::dynamic_pointer_cast<CompositeNode>(node_ptr);
+        if (composite_node_ptr) {
+            nodes.insert(nodes.end(), composite_node_ptr->GetChildren().begin(), composite_node_ptr->GetChildren().end());
+        } else if (node_ptr->GetChild() != nullptr) {
+            nodes.push_back(node_ptr->GetChild());
+        } else if (node_ptr->GetBehaviorState() == BehaviorState::RUNNING) {
+            running_leaves[node_ptr->GetConfigKey()]++;
+        }
+    }
+}
+
+// 优化前后的树逐帧返回相同的结果、产生相同的黑板数据，正在运行的叶子节点一致，被终止后都不留下运行中的节点
+bool CheckOptimizerEquivalence()
+{
+    OptimizeReport total;
+    for (unsigned int seed = 0; seed < 5000; seed++)
+    {
+        auto blackboard_ptr = std::make_shared<BlackBoard>();
+        auto optimized_blackboard_ptr = std::make_shared<BlackBoard>();
+        std::vector<BehaviorNode::Ptr> nodes, optimized_nodes;
+        std::mt19937 random(seed), optimized_random(seed);
+        BehaviorNode::Ptr root_node = GenerateOptimizableTree(random, blackboard_ptr, 4, nodes);
+        BehaviorNode::Ptr optimized_root_node = GenerateOptimizableTree(optimized_random, optimized_blackboard_ptr, 4,
+                                                                        optimized_nodes);
+        OptimizeReport report;
+        optimized_root_node = TreeOptimizer().Optimize(optimized_root_node, report);
+        if (optimized_root_node == nullptr) {
+            // 生成的并行节点阈值总是合法的
+            std::cerr << "seed " << seed << ": " << report.errors.front() << std::endl;
+            return false;
+        }
+        total.folded_composites += report.folded_composites;
+        total.flattened_composites += report.flattened_composites;
+        total.merged_leaves += report.merged_leaves;
+
+        for (unsigned int frame = 0; frame < 30; frame++)
+        {
+            int energy = std::uniform_int_distribution<int>(-30, 30)(random);
+            blackboard_ptr->adjustEnergy(energy);
+            optimized_blackboard_ptr->adjustEnergy(energy);
+
+            BehaviorState state = root_node->Run();
+            BehaviorState optimized_state = optimized_root_node->Run();
+            std::map<std::string, unsigned int> running_leaves, optimized_running_leaves;
+            CountRunningLeaves(root_node, running_leaves);
+            CountRunningLeaves(optimized_root_node, optimized_running_leaves);
+            if (state != optimized_state || blackboard_ptr->getEnergy() != optimized_blackboard_ptr->getEnergy()
+                || running_leaves != optimized_running_leaves) {
+                std::cerr << "seed " << seed << " frame " << frame << ": optimized tree differs" << std::endl;
+                return false;
+            }
+
+            // 不时从外部终止整棵树
+            if (frame % 7 == 6)
+            {
+                root_node->Reset();
+                optimized_root_node->Reset();
+                for (auto &nodes_ptr : {&nodes, &optimized_nodes}) {
+                    for (auto &node_ptr : *nodes_ptr) {
+                        CHECK(node_ptr->GetBehaviorState() != BehaviorState::RUNNING);
+                    }
+                }
+            }
+        }
+    }
+    // 随机树确实覆盖到了三种优化
+    CHECK(total.folded_composites > 0 && total.flattened_composites > 0 && total.merged_leaves > 0);
+    return true;
+}
+
+// 只依赖按名字存取的数据的条件，在本地数据或共享作用域更新后重新评估
+bool CheckIndexedSelectorValues()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    auto scope = std::make_shared<BlackBoardScope>();
+    blackboard_ptr->addScope(scope);
+    auto indexed_selector = std::make_shared<IndexedSelectorNode>("selector", blackboard_ptr);
+    for (auto key : {"alarm", "team_alarm"})
+    {
+        std::string name = key;
+        auto guard = std::make_shared<PreconditionNode>(name, AbortType::BOTH, blackboard_ptr, [blackboard_ptr, name](){
+            int value = 0;
+            return blackboard_ptr->getValue(name, value) && value == 1;
+        });
+        guard->SetChild(std::make_shared<ScriptedAction>(name + "_action", blackboard_ptr, 0, true,
+            ScriptedAction::Write::NONE, 0));
+        indexed_selector->AddChildren(guard, {BlackBoardKey::VALUES});
+    }
+    indexed_selector->AddChildren(std::make_shared<ScriptedAction>("fallback", blackboard_ptr, 0, false,
+        ScriptedAction::Write::NONE, 0));
+    BehaviorTree tree(indexed_selector, 0, blackboard_ptr);
+
+    CHECK(tree.Tick() == BehaviorState::FAILURE);
+    blackboard_ptr->setValue("alarm", 1);
+    CHECK(tree.Tick() == BehaviorState::SUCCESS);
+    blackboard_ptr->setValue("alarm", 0);
+    CHECK(tree.Tick() == BehaviorState::FAILURE);
+    scope->Update([](BlackBoardValues &values){values["team_alarm"] = 1;});
+    CHECK(tree.Tick() == BehaviorState::SUCCESS);
+    scope->Update([](BlackBoardValues &values){values["team_alarm"] = 0;});
+    CHECK(tree.Tick() == BehaviorState::FAILURE);
+    return true;
+}
+
+// 块内嵌套调用ParallelFor不会死锁，包括由调用线程执行的块
+bool CheckNestedParallelFor()
+{
+    auto worker_pool = std::make_shared<WorkerPool>(4);
+    std::thread::id caller = std::this_thread::get_id();
+    std::atomic<bool> caller_nested(false);
+    // 工作线程可能抢先取走全部的块，重复到调用线程也执行过嵌套调用为止
+    for (unsigned int round = 0; round < 1000 && !caller_nested.load(); round++)
+    {
+        std::atomic<unsigned int> count(0);
+        worker_pool->ParallelFor(64, 1, [&](size_t, size_t){
+            if (std::this_thread::get_id() == caller) {
+                caller_nested.store(true);
+            }
+            worker_pool->ParallelFor(16, 2, [&](size_t inner_begin, size_t inner_end){
+                count.fetch_add(inner_end - inner_begin);
+            });
+        });
+        CHECK(count.load() == 64 * 16);
+    }
+    CHECK(caller_nested.load());
+
+    // 共用线程池的ForEachNode嵌套
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    std::vector<int> elements(32);
+    auto outer = std::make_shared<ForEachNode<int>>("outer", blackboard_ptr, [&](){return elements;},
+        [&](const int &){
+            return std::make_shared<ForEachNode<int>>("inner", blackboard_ptr, [&](){return elements;},
+                [&](const int &){
+                    return std::make_shared<ScriptedAction>("action", blackboard_ptr, 0, true, ScriptedAction::Write::NONE, 0);
+                }, 0, worker_pool, 4);
+        }, 0, worker_pool, 4);
+    CHECK(outer->Run() == BehaviorState::SUCCESS);
+    return true;
+}
+
+// 预算耗尽返回后被终止，已在运行的元素子树也要复位
+bool CheckForEachAbortAfterYield()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    std::vector<BehaviorNode::Ptr> actions;
+    auto foreach_node = std::make_shared<ForEachNode<int>>("foreach", blackboard_ptr,
+        [](){return std::vector<int>{0, 1, 2, 3};},
+        [&](const int &element){
+            actions.push_back(std::make_shared<ScriptedAction>("action" + std::to_string(element), blackboard_ptr, 5, true,
+                ScriptedAction::Write::NONE, 0));
+            return actions.back();
+        });
+    {
+        // 预算为0，运行第一个元素后即停下
+        TickBudget tick_budget(std::chrono::microseconds(0));
+        CHECK(foreach_node->Run() == BehaviorState::RUNNING);
+        CHECK(tick_budget.Yielded());
+    }
+    CHECK(actions.size() == 4);
+    CHECK(actions.at(0)->GetBehaviorState() == BehaviorState::RUNNING);
+    CHECK(actions.at(1)->GetBehaviorState() == BehaviorState::IDLE);
+
+    foreach_node->Reset();
+    for (auto &action : actions) {
+        CHECK(action->GetBehaviorState() == BehaviorState::IDLE);
+    }
+    return true;
+}
+
+// 以下装饰节点的检查直接设置黑板上的时钟与遍历计数，不依赖真实经过的时间
+// 子节点结束后的冷却时间内直接返回FAILURE且不运行子节点；子节点被终止同样开始冷却
+bool CheckCooldown()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    std::chrono::steady_clock::time_point start_time = blackboard_ptr->now;
+    auto action = std::make_shared<CountingAction>("action", blackboard_ptr, BehaviorState::SUCCESS);
+    auto cooldown = std::make_shared<CooldownNode>("cooldown", blackboard_ptr, std::chrono::milliseconds(100));
+    cooldown->SetChild(action);
+
+    CHECK(cooldown->Run() == BehaviorState::SUCCESS);
+    blackboard_ptr->now = start_time + std::chrono::milliseconds(99);
+    CHECK(cooldown->Run() == BehaviorState::FAILURE);
+    CHECK(action->GetCount() == 1);
+    // 冷却中被拒绝的遍历不重新计时
+    blackboard_ptr->now = start_time + std::chrono::milliseconds(100);
+    CHECK(cooldown->Run() == BehaviorState::SUCCESS);
+    CHECK(action->GetCount() == 2);
+
+    auto running = std::make_shared<CountingAction>("running", blackboard_ptr, BehaviorState::RUNNING);
+    auto running_cooldown = std::make_shared<CooldownNode>("running_cooldown", blackboard_ptr, std::chrono::milliseconds(100));
+    running_cooldown->SetChild(running);
+    CHECK(running_cooldown->Run() == BehaviorState::RUNNING);
+    blackboard_ptr->now = start_time + std::chrono::milliseconds(150);
+    running_cooldown->Reset();
+    CHECK(running->GetTerminations() == std::vector<BehaviorState>{BehaviorState::IDLE});
+    blackboard_ptr->now = start_time + std::chrono::milliseconds(249);
+    CHECK(running_cooldown->Run() == BehaviorState::FAILURE);
+    CHECK(running->GetCount() == 1);
+    blackboard_ptr->now = start_time + std::chrono::milliseconds(250);
+    CHECK(running_cooldown->Run() == BehaviorState::RUNNING);
+    CHECK(running->GetCount() == 2);
+    return true;
+}
+
+// 运行子节点后的interval次遍历内返回缓存的结果；分支很久没有进入时重新运行子节点；被终止后不再返回缓存的RUNNING
+bool CheckThrottle()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    auto action = std::make_shared<CountingAction>("action", blackboard_ptr, BehaviorState::SUCCESS);
+    auto throttle = std::make_shared<ThrottleNode>("throttle", blackboard_ptr, 3);
+    throttle->SetChild(action);
+    bool enter = true;
+    auto guard = std::make_shared<PreconditionNode>("guard", AbortType::NONE, blackboard_ptr, [&enter](){return enter;});
+    guard->SetChild(throttle);
+    BehaviorTree tree(guard, 0, blackboard_ptr);
+
+    for (unsigned int tick = 0; tick < 7; tick++)
+    {
+        CHECK(tree.Tick() == BehaviorState::SUCCESS);
+        CHECK(action->GetCount() == tick / 3 + 1);
+    }
+    // 只进入一次分支，之前的结果早已过期
+    enter = false;
+    for (unsigned int tick = 0; tick < 10; tick++) {
+        CHECK(tree.Tick() == BehaviorState::FAILURE);
+    }
+    enter = true;
+    CHECK(tree.Tick() == BehaviorState::SUCCESS);
+    CHECK(action->GetCount() == 4);
+
+    auto running = std::make_shared<CountingAction>("running", blackboard_ptr, BehaviorState::RUNNING);
+    auto running_throttle = std::make_shared<ThrottleNode>("running_throttle", blackboard_ptr, 3);
+    running_throttle->SetChild(running);
+    CHECK(running_throttle->Run() == BehaviorState::RUNNING);
+    CHECK(running_throttle->Run() == BehaviorState::RUNNING);
+    CHECK(running->GetCount() == 1);
+    running_throttle->Reset();
+    CHECK(running->GetBehaviorState() == BehaviorState::IDLE);
+    CHECK(running->GetTerminations() == std::vector<BehaviorState>{BehaviorState::IDLE});
+    // 同一次遍历中重新进入，子节点重新启动
+    CHECK(running_throttle->Run() == BehaviorState::RUNNING);
+    CHECK(running->GetCount() == 2);
+    CHECK(running->GetBehaviorState() == BehaviorState::RUNNING);
+    return true;
+}
+
+// 子节点连续运行达到时限后返回FAILURE并复位子节点，再次进入时重新计时
+bool CheckTimeout()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    std::chrono::steady_clock::time_point start_time = blackboard_ptr->now;
+    auto running = std::make_shared<CountingAction>("running", blackboard_ptr, BehaviorState::RUNNING);
+    auto timeout = std::make_shared<TimeoutNode>("timeout", blackboard_ptr, std::chrono::milliseconds(100));
+    timeout->SetChild(running);
+
+    CHECK(timeout->Run() == BehaviorState::RUNNING);
+    blackboard_ptr->now = start_time + std::chrono::milliseconds(99);
+    CHECK(timeout->Run() == BehaviorState::RUNNING);
+    CHECK(running->GetTerminations().empty());
+    blackboard_ptr->now = start_time + std::chrono::milliseconds(100);
+    CHECK(timeout->Run() == BehaviorState::FAILURE);
+    CHECK(running->GetBehaviorState() == BehaviorState::IDLE);
+    CHECK(running->GetTerminations() == std::vector<BehaviorState>{BehaviorState::IDLE});
+    CHECK(running->GetCount() == 2);
+
+    blackboard_ptr->now = start_time + std::chrono::milliseconds(150);
+    CHECK(timeout->Run() == BehaviorState::RUNNING);
+    blackboard_ptr->now = start_time + std::chrono::milliseconds(249);
+    CHECK(timeout->Run() == BehaviorState::RUNNING);
+    CHECK(running->GetCount() == 4);
+    return true;
+}
+
+// 每次遍历最多尝试一次，达到次数后返回FAILURE；子节点成功时立即返回，再次进入时重新计数
+bool CheckRetry()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    auto action = std::make_shared<CountingAction>("action", blackboard_ptr, BehaviorState::SUCCESS);
+    bool succeed = false;
+    auto guard = std::make_shared<PreconditionNode>("guard", AbortType::NONE, blackboard_ptr, [&succeed](){return succeed;});
+    guard->SetChild(action);
+    auto retry = std::make_shared<RetryNode>("retry", blackboard_ptr, 3);
+    retry->SetChild(guard);
+
+    for (unsigned int attempt = 1; attempt <= 3; attempt++)
+    {
+        CHECK(retry->Run() == (attempt < 3 ? BehaviorState::RUNNING : BehaviorState::FAILURE));
+        CHECK(guard->GetBehaviorState() == BehaviorState::FAILURE);
+    }
+
+    CHECK(retry->Run() == BehaviorState::RUNNING);
+    succeed = true;
+    CHECK(retry->Run() == BehaviorState::SUCCESS);
+    CHECK(action->GetCount() == 1);
+    // 成功后重新计数，仍有3次尝试
+    succeed = false;
+    CHECK(retry->Run() == BehaviorState::RUNNING);
+    CHECK(retry->Run() == BehaviorState::RUNNING);
+    succeed = true;
+    CHECK(retry->Run() == BehaviorState::SUCCESS);
+    CHECK(action->GetCount() == 2);
+    return true;
+}
+
+// 在线程池中进入、结束的子树实例，计数与空闲登记都不会丢失
+bool CheckSubtreeEvictorThreads()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    auto worker_pool = std::make_shared<WorkerPool>(4);
+    auto evictor = std::make_shared<SubtreeEvictor>(std::chrono::milliseconds(0));
+    auto definition = std::make_shared<SubtreeDefinition>("definition", [](const BlackBoard::Ptr &blackboard_ptr){
+        return std::make_shared<ScriptedAction>("action", blackboard_ptr, 0, true, ScriptedAction::Write::NONE, 0);
+    });
+    std::vector<int> elements(1024);
+    auto foreach_node = std::make_shared<ForEachNode<int>>("foreach", blackboard_ptr, [&](){return elements;},
+        [&](const int &){
+            return std::make_shared<SubtreeNode>("subtree", blackboard_ptr, definition, evictor);
+        }, 0, worker_pool, 8);
+    for (unsigned int round = 0; round < 4; round++)
+    {
+        CHECK(foreach_node->Run() == BehaviorState::SUCCESS);
+        CHECK(evictor->GetInstanceCount() == elements.size());
+        evictor->Sweep(std::chrono::steady_clock::now() + std::chrono::hours(1));
+        CHECK(evictor->GetInstanceCount() == 0);
+    }
+    return true;
+}
+
+// 超出取值范围的共享内存输入整条丢弃，不写入黑板
+bool CheckShmInputValidation()
+{
+    auto segment = ShmSegment::Create("/regression_checks." + std::to_string(getpid()), 1);
+    CHECK(segment != nullptr);
+    ShmBinding shm_binding(segment, 0);
+    BlackBoard blackboard;
+    blackboard.setPosition(Position::MINE);
+    blackboard.adjustEnergy(-50);
+
+    const int32_t inputs[][2] = {{-1, 30}, {3, 30}, {0, -1}, {0, 101}};
+    for (auto &input : inputs)
+    {
+        int32_t values[ShmBlock::FIELD_COUNT] = {0};
+        values[(int)ShmField::POSITION] = input[0];
+        values[(int)ShmField::ENERGY] = input[1];
+        segment->GetSlot(0)->input.Write(values);
+        CHECK(!shm_binding.Pull(blackboard));
+        CHECK(blackboard.getPosition() == Position::MINE && blackboard.getEnergy() == 50);
+    }
+
+    int32_t values[ShmBlock::FIELD_COUNT] = {0};
+    values[(int)ShmField::POSITION] = (int32_t)Position::SCHOOL;
+    values[(int)ShmField::ENERGY] = 10;
+    segment->GetSlot(0)->input.Write(values);
+    CHECK(shm_binding.Pull(blackboard));
+    CHECK(blackboard.getPosition() == Position::SCHOOL && blackboard.getEnergy() == 10);
+    return true;
+}
+
+BehaviorNode::Ptr GenerateSwapTree(const BlackBoard::Ptr &blackboard_ptr, const std::string &destination_name)
+{
+    auto sequence = std::make_shared<SequenceNode>("sequence", blackboard_ptr);
+    sequence->AddChildren(std::make_shared<ScriptedAction>("tired", blackboard_ptr, 0, true, ScriptedAction::Write::ENERGY, -10));
+    sequence->AddChildren(std::make_shared<ChangePositionAction>(destination_name, blackboard_ptr, Position::MINE));
+    return sequence;
+}
+
+// 热替换后同名节点接管运行状态：序列节点从原位置继续，移动动作按原来的开始时间完成；改名的节点不接管，旧树被复位
+bool CheckHotSwapCarryOver()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    auto old_root = GenerateSwapTree(blackboard_ptr, "go_mine");
+    BehaviorTree tree(old_root, 0, blackboard_ptr);
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    CHECK(tree.Tick() == BehaviorState::RUNNING);
+    CHECK(blackboard_ptr->getEnergy() == 90);
+
+    auto new_root = GenerateSwapTree(blackboard_ptr, "go_mine");
+    CHECK(tree.GetSwapStatus() == SwapStatus::NONE);
+    CHECK(tree.Swap(new_root));
+    CHECK(tree.GetSwapStatus() == SwapStatus::PENDING);
+    CHECK(tree.Tick() == BehaviorState::RUNNING);
+    CHECK(tree.GetRoot() == new_root);
+    CHECK(tree.GetSwapStatus() == SwapStatus::APPLIED);
+    // 接管后不再重新运行左侧已完成的子节点，旧节点静默退出
+    CHECK(blackboard_ptr->getEnergy() == 90);
+    CHECK(old_root->GetBehaviorState() == BehaviorState::IDLE);
+    auto &children = std::dynamic_pointer_cast<CompositeNode>(new_root)->GetChildren();
+    CHECK(children.at(0)->GetBehaviorState() == BehaviorState::IDLE);
+    CHECK(children.at(1)->GetBehaviorState() == BehaviorState::RUNNING);
+
+    // 移动耗时500ms，从替换前开始计时
+    std::this_thread::sleep_until(start_time + std::chrono::milliseconds(550));
+    CHECK(tree.Tick() == BehaviorState::SUCCESS);
+    CHECK(blackboard_ptr->getPosition() == Position::MINE);
+
+    // 改名后无法对应，新树从头开始
+    blackboard_ptr->setPosition(Position::HOME);
+    CHECK(tree.Tick() == BehaviorState::RUNNING);
+    CHECK(blackboard_ptr->getEnergy() == 80);
+    auto renamed_root = GenerateSwapTree(blackboard_ptr, "go_mine_renamed");
+    CHECK(tree.Swap(renamed_root));
+    CHECK(tree.Tick() == BehaviorState::RUNNING);
+    CHECK(blackboard_ptr->getEnergy() == 70);
+    CHECK(children.at(1)->GetBehaviorState() == BehaviorState::IDLE);
+    CHECK(new_root->GetBehaviorState() == BehaviorState::IDLE);
+
+    // 与正在运行的树共用节点的新树通过校验，但在替换前被拒绝
+    auto shared_root = std::make_shared<SequenceNode>("shared", blackboard_ptr);
+    shared_root->AddChildren(std::dynamic_pointer_cast<CompositeNode>(renamed_root)->GetChildren().at(1));
+    CHECK(tree.Swap(shared_root));
+    CHECK(tree.GetSwapStatus() == SwapStatus::PENDING);
+    CHECK(tree.Tick() == BehaviorState::RUNNING);
+    CHECK(tree.GetRoot() == renamed_root);
+    CHECK(tree.GetSwapStatus() == SwapStatus::REJECTED);
+
+    // 校验失败时直接返回false
+    CHECK(!tree.Swap(std::make_shared<SequenceNode>("empty", blackboard_ptr)));
+    CHECK(tree.GetSwapStatus() == SwapStatus::REJECTED);
+    return true;
+}
+
+// 绑定在临时路径上的数据报接收端，用于检查StatePublisher发出的消息
+class StreamReceiver
+{
+public:
+    StreamReceiver() :
+        path_("/tmp/regression_checks." + std::to_string(getpid()) + ".sock")
+    {
+        struct sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, path_.c_str(), sizeof(address.sun_path) - 1);
+        fd_ = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+        unlink(path_.c_str());
+        if (fd_ >= 0 && bind(fd_, (const struct sockaddr*)&address, sizeof(address)) != 0) {
+            std::cerr << "bind " << path_ << " failed: " << std::strerror(errno) << std::endl;
+        }
+    }
+
+    ~StreamReceiver()
+    {
+        close(fd_);
+        unlink(path_.c_str());
+    }
+
+    std::string GetPath()
+    {
+        return path_;
+    }
+
+    // 读出已到达的全部消息，返回其中节点表的记录数
+    unsigned int CountSchemaRecords()
+    {
+        unsigned int records = 0;
+        std::vector<uint8_t> buffer(StateStream::MAX_MESSAGE_SIZE);
+        ssize_t size;
+        while ((size = recv(fd_, buffer.data(), buffer.size(), 0)) > 0)
+        {
+            const uint8_t *data = buffer.data() + 1;
+            const uint8_t *end = buffer.data() + size;
+            uint64_t tree_id, epoch, sequence, count;
+            if (buffer.at(0) == (uint8_t)StateMessageType::SCHEMA_NODES && StateStream::GetVarint(data, end, tree_id)
+                && StateStream::GetVarint(data, end, epoch) && StateStream::GetVarint(data, end, sequence)
+                && StateStream::GetVarint(data, end, count)) {
+                records += count;
+            }
+        }
+        return records;
+    }
+
+    // 读出已到达的全部消息，返回其中状态变化消息携带的遍历次数
+    std::vector<uint64_t> ReadFrameTicks()
+    {
+        std::vector<uint64_t> ticks;
+        std::vector<uint8_t> buffer(StateStream::MAX_MESSAGE_SIZE);
+        ssize_t size;
+        while ((size = recv(fd_, buffer.data(), buffer.size(), 0)) > 0)
+        {
+            const uint8_t *data = buffer.data() + 1;
+            const uint8_t *end = buffer.data() + size;
+            uint64_t tree_id, epoch, sequence, tick;
+            if (buffer.at(0) == (uint8_t)StateMessageType::FRAME && StateStream::GetVarint(data, end, tree_id)
+                && StateStream::GetVarint(data, end, epoch) && StateStream::GetVarint(data, end, sequence)
+                && StateStream::GetVarint(data, end, tick)) {
+                ticks.push_back(tick);
+            }
+        }
+        return ticks;
+    }
+
+private:
+    std::string path_;
+    int fd_;
+};
+
+// 优化器合并的叶子节点在树中出现两次，只发布一条记录
+bool CheckPublisherMergedLeaves()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    auto selector = std::make_shared<SelectorNode>("selector", blackboard_ptr);
+    for (unsigned int index = 0; index < 2; index++)
+    {
+        auto sequence = std::make_shared<SequenceNode>("sequence" + std::to_string(index), blackboard_ptr);
+        sequence->AddChildren(std::make_shared<ScriptedAction>("action" + std::to_string(index), blackboard_ptr,
+            0, false, ScriptedAction::Write::NONE, 0));
+        sequence->AddChildren(std::make_shared<ChangePositionAction>("go_home" + std::to_string(index), blackboard_ptr,
+            Position::HOME));
+        selector->AddChildren(sequence);
+    }
+    OptimizeReport report;
+    BehaviorNode::Ptr root_node = TreeOptimizer().Optimize(selector, report);
+    CHECK(root_node != nullptr && report.merged_leaves == 1 && report.node_count_after == 6);
+
+    StreamReceiver receiver;
+    auto state_publisher = std::make_shared<StatePublisher>(receiver.GetPath());
+    state_publisher->Attach(root_node);
+    state_publisher->Flush(0);
+    CHECK(state_publisher->GetDroppedCount() == 0);
+    CHECK(receiver.CountSchemaRecords() == 6);
+    state_publisher->Detach();
+    return true;
+}
+
+// 回收的子树实例中含有ForEachNode时，元素子树随之注销，之后发布的节点表只剩常驻的节点
+bool CheckPublisherSubtreeEviction()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    auto definition = std::make_shared<SubtreeDefinition>("definition", [](const BlackBoard::Ptr &blackboard_ptr){
+        return std::make_shared<ForEachNode<int>>("foreach", blackboard_ptr, [](){return std::vector<int>{0, 1, 2};},
+            [blackboard_ptr](const int &){
+                auto sequence = std::make_shared<SequenceNode>("sequence", blackboard_ptr);
+                sequence->AddChildren(std::make_shared<ScriptedAction>("action", blackboard_ptr, 0, true,
+                    ScriptedAction::Write::NONE, 0));
+                return sequence;
+            });
+    });
+    auto evictor = std::make_shared<SubtreeEvictor>(std::chrono::milliseconds(0));
+    auto root_node = std::make_shared<SequenceNode>("root", blackboard_ptr);
+    root_node->AddChildren(std::make_shared<SubtreeNode>("subtree", blackboard_ptr, definition, evictor));
+
+    StreamReceiver receiver;
+    auto state_publisher = std::make_shared<StatePublisher>(receiver.GetPath());
+    {
+        BehaviorTree tree(root_node, 0, blackboard_ptr);
+        tree.SetSubtreeEvictor(evictor);
+        tree.SetStatePublisher(state_publisher);
+        for (unsigned int frame = 0; frame < 3; frame++)
+        {
+            CHECK(tree.Tick() == BehaviorState::SUCCESS);
+            // 子树实例在本帧结束时被回收
+            CHECK(evictor->GetInstanceCount() == 0);
+            CHECK(receiver.CountSchemaRecords() == 2);
+        }
+        // 不再回收，子树实例存活期间释放发布者，树中的节点不能留下指向它的指针
+        tree.SetSubtreeEvictor(nullptr);
+        CHECK(tree.Tick() == BehaviorState::SUCCESS);
+        CHECK(evictor->GetInstanceCount() == 1);
+        tree.SetStatePublisher(nullptr);
+        state_publisher = nullptr;
+    }
+    std::vector<BehaviorNode::Ptr> nodes = {root_node};
+    for (unsigned int index = 0; index < nodes.size(); index++)
+    {
+        auto node_ptr = nodes.at(index);
+        CHECK(node_ptr->GetStateListener() == nullptr);
+        auto composite_node_ptr = std::dynamic_pointer_cast<CompositeNode>(node_ptr);
+        if (composite_node_ptr) {
+            nodes.insert(nodes.end(), composite_node_ptr->GetChildren().begin(), composite_node_ptr->GetChildren().end());
+        } else if (node_ptr->GetChild() != nullptr) {
+            nodes.push_back(node_ptr->GetChild());
+        }
+        node_ptr->GetDynamicChildren(nodes);
+    }
+    // root、subtree、foreach以及3个元素各自的sequence、action
+    CHECK(nodes.size() == 9);
+    return true;
+}
+
+// 调试器数据流与共享内存中的帧号都是本树的遍历次数，不依赖调用者维护BlackBoard::frame
+bool CheckFrameCounter()
+{
+    auto blackboard_ptr = std::make_shared<BlackBoard>();
+    auto root_node = std::make_shared<SequenceNode>("root", blackboard_ptr);
+    // 运行与成功交替，每次遍历都有状态变化要发布
+    root_node->AddChildren(std::make_shared<ScriptedAction>("action", blackboard_ptr, 1, true,
+        ScriptedAction::Write::NONE, 0));
+
+    auto segment = ShmSegment::Create("/regression_checks." + std::to_string(getpid()), 1);
+    CHECK(segment != nullptr);
+    StreamReceiver receiver;
+    BehaviorTree tree(root_node, 0, blackboard_ptr);
+    tree.SetShmBinding(std::make_shared<ShmBinding>(segment, 0));
+    tree.SetStatePublisher(std::make_shared<StatePublisher>(receiver.GetPath()));
+    // 第一次遍历发送节点表
+    CHECK(tree.Tick() == BehaviorState::RUNNING);
+    receiver.ReadFrameTicks();
+    for (uint64_t tick = 2; tick <= 5; tick++)
+    {
+        CHECK(tree.Tick() == (tick % 2 == 0 ? BehaviorState::SUCCESS : BehaviorState::RUNNING));
+        CHECK(receiver.ReadFrameTicks() == std::vector<uint64_t>{tick});
+        int32_t values[ShmBlock::FIELD_COUNT];
+        uint32_t sequence;
+        CHECK(segment->GetSlot(0)->output.Read(values, sequence));
+        CHECK(values[(int)ShmField::FRAME] == (int32_t)tick);
+    }
+    CHECK(blackboard_ptr->frame == 0);
+    tree.SetStatePublisher(nullptr);
+    return true;
+}
+
+struct Check
+{
+    const char *name;
+    bool (*function)();
+};
+
+int main(int argc, char **argv)
+{
+    BehaviorNode::SetLogEnabled(false);
+    std::vector<Check> checks = {
+        {"indexed_selector_equivalence", CheckIndexedSelectorEquivalence},
+        {"lod_scheduler", CheckLodScheduler},
+        {"budgeted_yield", CheckBudgetedYield},
+        {"parallel_abort", CheckParallelAbort},
+        {"indexed_selector_clear_children", CheckIndexedSelectorClearChildren},
+        {"optimizer_equivalence", CheckOptimizerEquivalence},
+        {"publisher_merged_leaves", CheckPublisherMergedLeaves},
+        {"indexed_selector_values", CheckIndexedSelectorValues},
+        {"nested_parallel_for", CheckNestedParallelFor},
+        {"foreach_abort_after_yield", CheckForEachAbortAfterYield},
+        {"cooldown", CheckCooldown},
+        {"throttle", CheckThrottle},
+        {"timeout", CheckTimeout},
+        {"retry", CheckRetry},
+        {"subtree_evictor_threads", CheckSubtreeEvictorThreads},
+        {"shm_input_validation", CheckShmInputValidation},
+        {"hot_swap_carry_over", CheckHotSwapCarryOver},
+        {"publisher_subtree_eviction", CheckPublisherSubtreeEviction},
+        {"frame_counter", CheckFrameCounter},
+    };
+
+    unsigned int failures = 0;
+    for (auto &check : checks)
+    {
+        bool selected = argc < 2;
+        for (int index = 1; index < argc; index++) {
+            selected = selected || std::string(argv[index]) == check.name;
+        }
+        if (!selected) {
+            continue;
+        }
+        bool passed = check.function();
+        std::cout << (passed ? "PASS " : "FAIL ") << check.name << std::endl;
+        if (!passed) {
+            failures++;
+        }
+    }
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
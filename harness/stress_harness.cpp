@@ -0,0 +1,510 @@
+#include<lod_scheduler.h>
+#include<tree_optimizer.h>
+#include<atomic>
+#include<cmath>
+#include<cstdio>
+#include<cstdlib>
+#include<fstream>
+#include<new>
+#include<random>
+#include<sstream>
+#include<sys/resource.h>
+#include<sys/wait.h>
+#include<unistd.h>
+
+/**
+ * 规模压力测试：随机生成合法的行为树与智能体群体，在固定的帧预算下遍历，
+ * 统计每秒遍历次数、单次遍历与整帧耗时的分布、峰值内存、每个智能体的堆内存以及每次遍历的堆分配次数，
+ * 并与基线文件比较，超出门限时以非0退出。
+ * 每个场景先运行frames/10帧（至少1帧）预热，不计入统计；样本少于MIN_P99_SAMPLES时p99没有意义，不输出也不能作为门限。
+ *
+ * stress_harness [--budget-us N] [--seed N] [--baseline FILE | --no-baseline]
+ *                [--scenario name:nodes:agents:frames]...
+ * 指定--scenario时只运行指定的场景，如 --scenario agents_1m:10:1000000:10
+ */
+
+// 统计堆分配，替换全局operator new
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<unsigned long> g_allocations(0);
+static std::atomic<unsigned long> g_allocated_bytes(0);
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    void *ptr = std::malloc(size == 0 ? 1 : size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+// 条件节点读取的全局帧号，每帧更新一次
+static unsigned int g_frame = 0;
+
+// 单次遍历耗时的样本，由TimedRoot写入，容量预先分配，统计期间不分配内存；为nullptr时不记录（预热）
+static std::vector<float> *g_tick_ms = nullptr;
+
+// p99至少需要的样本数，此时p99以上还有10个样本，不会退化成单个最慢的样本
+static const size_t MIN_P99_SAMPLES = 1000;
+
+// 运行固定次数遍历后以固定结果结束的动作节点
+class StressAction : public ActionNode
+{
+public:
+    StressAction(std::string name, const BlackBoard::Ptr &blackboard_ptr, unsigned int duration, bool success):
+        ActionNode(name, blackboard_ptr),
+        duration_(duration),
+        ticks_(0),
+        success_(success){}
+
+    virtual ~StressAction(){}
+
+private:
+    virtual void OnInitialize()
+    {
+        ticks_ = 0;
+    }
+
+    virtual BehaviorState Update()
+    {
+        if (ticks_++ < duration_) {
+            return BehaviorState::RUNNING;
+        }
+        return success_ ? BehaviorState::SUCCESS : BehaviorState::FAILURE;
+    }
+
+    virtual void OnTerminate(BehaviorState state)
+    {
+
+    }
+
+    unsigned int duration_;
+    unsigned int ticks_;
+    bool success_;
+};
+
+// 包在生成的树外面，记录每次遍历整棵树的耗时
+class TimedRoot : public ActionNode
+{
+public:
+    TimedRoot(const BehaviorNode::Ptr &child_node_ptr, const BlackBoard::Ptr &blackboard_ptr):
+        ActionNode("timed_root", blackboard_ptr),
+        child_node_ptr_(child_node_ptr){}
+
+    virtual ~TimedRoot(){}
+
+private:
+    virtual void OnInitialize(){}
+
+    virtual BehaviorState Update()
+    {
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+        BehaviorState state = child_node_ptr_->Run();
+        if (g_tick_ms != nullptr && g_tick_ms->size() < g_tick_ms->capacity()) {
+            g_tick_ms->push_back(std::chrono::duration<float, std::milli>(
+                std::chrono::steady_clock::now() - start_time).count());
+        }
+        return state;
+    }
+
+    virtual void OnTerminate(BehaviorState state)
+    {
+        if (state == BehaviorState::IDLE) {
+            ResetRunning(child_node_ptr_);
+        }
+    }
+
+    BehaviorNode::Ptr child_node_ptr_;
+};
+
+// 按节点数生成随机树，相同的种子生成相同的树
+class TreeGenerator
+{
+public:
+    TreeGenerator(unsigned int seed) :
+        random_(seed),
+        node_index_(0){}
+
+    BehaviorNode::Ptr Generate(unsigned int node_count, const BlackBoard::Ptr &blackboard_ptr)
+    {
+        node_index_ = 0;
+        return Build(node_count, blackboard_ptr);
+    }
+
+private:
+    unsigned int Uniform(unsigned int min, unsigned int max)
+    {
+        return std::uniform_int_distribution<unsigned int>(min, max)(random_);
+    }
+
+    BehaviorNode::Ptr Build(unsigned int node_count, const BlackBoard::Ptr &blackboard_ptr)
+    {
+        std::string name = "n" + std::to_string(node_index_++);
+        if (node_count == 1) {
+            return std::make_shared<StressAction>(name, blackboard_ptr, Uniform(0, 3), Uniform(0, 3) != 0);
+        }
+
+        // 条件节点占比较低，避免树退化成长链
+        if (node_count == 2 || Uniform(0, 9) == 0)
+        {
+            static const AbortType abort_types[] = {AbortType::NONE, AbortType::SELF, AbortType::LOW_PRIORITY, AbortType::BOTH};
+            unsigned int modulus = Uniform(2, 5);
+            auto precondition_node = std::make_shared<PreconditionNode>(name, abort_types[Uniform(0, 3)], blackboard_ptr,
+                [modulus](){return g_frame % modulus != 0;});
+            precondition_node->SetChild(Build(node_count - 1, blackboard_ptr));
+            return precondition_node;
+        }
+
+        // 子树大小均分，树高约为log(node_count)
+        unsigned int children_count = std::min(node_count - 1, Uniform(2, 8));
+        std::shared_ptr<CompositeNode> composite_node;
+        switch (Uniform(0, 2)) {
+            case 0:
+                composite_node = std::make_shared<SelectorNode>(name, blackboard_ptr);
+                break;
+            case 1:
+                composite_node = std::make_shared<SequenceNode>(name, blackboard_ptr);
+                break;
+            default:
+                composite_node = std::make_shared<ParallelNode>(name, blackboard_ptr, Uniform(1, children_count));
+                break;
+        }
+        unsigned int remaining = node_count - 1;
+        for (unsigned int index = 0; index < children_count; index++)
+        {
+            unsigned int children_node_count = remaining / (children_count - index);
+            composite_node->AddChildren(Build(children_node_count, blackboard_ptr));
+            remaining -= children_node_count;
+        }
+        return composite_node;
+    }
+
+    std::mt19937 random_;
+    unsigned int node_index_;
+};
+
+struct Scenario
+{
+    std::string name;
+    unsigned int node_count;
+    unsigned int agent_count;
+    unsigned int frames;
+};
+
+// 通过管道从子进程传回，只能包含平凡类型
+// p50_ms、p99_ms、max_ms为单次遍历耗时，frame_*为整帧耗时
+struct Result
+{
+    bool valid;
+    unsigned long ticks;
+    unsigned long samples;
+    double ticks_per_sec;
+    double p50_ms;
+    double p99_ms;
+    double max_ms;
+    double frame_p50_ms;
+    double frame_max_ms;
+    long peak_rss_kb;
+    double bytes_per_agent;
+    double allocations_per_tick;
+};
+
+Result RunScenario(const Scenario &scenario, std::chrono::microseconds frame_budget, unsigned int seed)
+{
+    Result result = Result();
+    BehaviorNode::SetLogEnabled(false);
+
+    unsigned long allocated_bytes = g_allocated_bytes.load();
+    LodScheduler scheduler(0, {1}, {0.0f});
+    scheduler.SetFrameBudget(frame_budget);
+    std::vector<BehaviorTree::Ptr> trees;
+    trees.reserve(scenario.agent_count);
+    for (unsigned int agent = 0; agent < scenario.agent_count; agent++)
+    {
+        auto blackboard_ptr = std::make_shared<BlackBoard>();
+        TreeGenerator generator(seed + agent);
+        BehaviorNode::Ptr root_node = generator.Generate(scenario.node_count, blackboard_ptr);
+        if (agent == 0)
+        {
+            TreeOptimizer optimizer;
+            std::vector<std::string> errors;
+            if (!optimizer.Validate(root_node, errors))
+            {
+                for (auto &error : errors) {
+                    std::cerr << scenario.name << " tree invalid: " << error << std::endl;
+                }
+                return result;
+            }
+        }
+        trees.push_back(std::make_shared<BehaviorTree>(std::make_shared<TimedRoot>(root_node, blackboard_ptr), 0,
+                                                       blackboard_ptr));
+        scheduler.AddAgent(trees.back());
+    }
+    result.bytes_per_agent = (double)(g_allocated_bytes.load() - allocated_bytes) / scenario.agent_count;
+
+    unsigned int warmup_frames = std::max(1u, scenario.frames / 10);
+    for (unsigned int frame = 0; frame < warmup_frames; frame++)
+    {
+        g_frame = frame;
+        scheduler.Step();
+    }
+
+    // 每个智能体每帧最多遍历一次
+    std::vector<float> tick_ms;
+    tick_ms.reserve((size_t)scenario.agent_count * scenario.frames);
+    std::vector<double> frame_ms;
+    frame_ms.reserve(scenario.frames);
+    g_tick_ms = &tick_ms;
+    unsigned long allocations = g_allocations.load();
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    for (unsigned int frame = warmup_frames; frame < warmup_frames + scenario.frames; frame++)
+    {
+        g_frame = frame;
+        std::chrono::steady_clock::time_point frame_start_time = std::chrono::steady_clock::now();
+        scheduler.Step();
+        frame_ms.push_back(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - frame_start_time).count());
+        result.ticks += scheduler.GetTicksLastFrame();
+    }
+    double elapsed_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    allocations = g_allocations.load() - allocations;
+    g_tick_ms = nullptr;
+
+    result.ticks_per_sec = elapsed_sec > 0 ? result.ticks / elapsed_sec : 0;
+    result.allocations_per_tick = result.ticks > 0 ? (double)allocations / result.ticks : 0;
+    result.samples = tick_ms.size();
+    if (!tick_ms.empty())
+    {
+        std::sort(tick_ms.begin(), tick_ms.end());
+        result.p50_ms = tick_ms.at(tick_ms.size() / 2);
+        result.p99_ms = tick_ms.size() >= MIN_P99_SAMPLES ? tick_ms.at(tick_ms.size() * 99 / 100) : NAN;
+        result.max_ms = tick_ms.back();
+    }
+    std::sort(frame_ms.begin(), frame_ms.end());
+    result.frame_p50_ms = frame_ms.at(frame_ms.size() / 2);
+    result.frame_max_ms = frame_ms.back();
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result.peak_rss_kb = usage.ru_maxrss;
+    result.valid = true;
+    return result;
+}
+
+// 每个场景在独立的子进程中运行，峰值内存互不影响，内存耗尽被终止时记为失败
+Result RunIsolated(const Scenario &scenario, std::chrono::microseconds frame_budget, unsigned int seed)
+{
+    Result result = Result();
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cerr << "pipe failed" << std::endl;
+        return result;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "fork failed" << std::endl;
+        close(fds[0]);
+        close(fds[1]);
+        return result;
+    }
+    if (pid == 0)
+    {
+        close(fds[0]);
+        result = RunScenario(scenario, frame_budget, seed);
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t size = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (size != sizeof(result) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << scenario.name << " crashed or was killed" << std::endl;
+        result = Result();
+    }
+    return result;
+}
+
+bool GetMetric(const Result &result, const std::string &metric, double &value)
+{
+    if (metric == "ticks_per_sec") value = result.ticks_per_sec;
+    else if (metric == "p50_ms") value = result.p50_ms;
+    else if (metric == "p99_ms") value = result.p99_ms;
+    else if (metric == "max_ms") value = result.max_ms;
+    else if (metric == "frame_p50_ms") value = result.frame_p50_ms;
+    else if (metric == "frame_max_ms") value = result.frame_max_ms;
+    else if (metric == "peak_rss_kb") value = result.peak_rss_kb;
+    else if (metric == "bytes_per_agent") value = result.bytes_per_agent;
+    else if (metric == "allocations_per_tick") value = result.allocations_per_tick;
+    else return false;
+    return true;
+}
+
+/**
+ * 基线文件每行一条门限：<场景> <指标> <>=或<=> <数值>，#开头为注释
+ * 如：tree_1k ticks_per_sec >= 20000
+ * 返回不满足的门限数，文件格式错误也计入
+ */
+unsigned int CheckBaseline(const std::string &path, const std::vector<Scenario> &scenarios, const std::vector<Result> &results)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "can't open baseline file " << path << std::endl;
+        return 1;
+    }
+    unsigned int failures = 0;
+    std::string line;
+    unsigned int line_number = 0;
+    while (std::getline(file, line))
+    {
+        line_number++;
+        std::istringstream stream(line);
+        std::string name, metric, op;
+        double threshold;
+        if (!(stream >> name) || name.at(0) == '#') {
+            continue;
+        }
+        if (!(stream >> metric >> op >> threshold) || (op != ">=" && op != "<=")) {
+            std::cerr << path << ":" << line_number << ": malformed baseline" << std::endl;
+            failures++;
+            continue;
+        }
+        unsigned int index = 0;
+        while (index < scenarios.size() && scenarios.at(index).name != name) {
+            index++;
+        }
+        // 没有运行的场景不检查
+        if (index == scenarios.size()) {
+            continue;
+        }
+        const Result &result = results.at(index);
+        double value;
+        if (!GetMetric(result, metric, value)) {
+            std::cerr << path << ":" << line_number << ": unknown metric " << metric << std::endl;
+            failures++;
+            continue;
+        }
+        if (result.valid && std::isnan(value)) {
+            std::cerr << path << ":" << line_number << ": " << name << " has " << result.samples
+                      << " tick samples, too few for " << metric << std::endl;
+            failures++;
+            continue;
+        }
+        if (!result.valid || (op == ">=" ? value < threshold : value > threshold))
+        {
+            std::cerr << "REGRESSION " << name << " " << metric << " = " << value
+                      << ", expected " << op << " " << threshold << std::endl;
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    std::chrono::microseconds frame_budget(16000);
+    unsigned int seed = 1;
+#ifdef STRESS_BASELINE_FILE
+    std::string baseline = STRESS_BASELINE_FILE;
+#else
+    std::string baseline = "harness/baselines.txt";
+#endif
+    std::vector<Scenario> scenarios;
+
+    for (int index = 1; index < argc; index++)
+    {
+        std::string arg = argv[index];
+        if (arg == "--no-baseline") {
+            baseline.clear();
+        } else if (index + 1 < argc && arg == "--budget-us") {
+            frame_budget = std::chrono::microseconds(std::stoul(argv[++index]));
+        } else if (index + 1 < argc && arg == "--seed") {
+            seed = std::stoul(argv[++index]);
+        } else if (index + 1 < argc && arg == "--baseline") {
+            baseline = argv[++index];
+        } else if (index + 1 < argc && arg == "--scenario") {
+            Scenario scenario;
+            std::istringstream stream(argv[++index]);
+            std::string node_count, agent_count, frames;
+            if (!std::getline(stream, scenario.name, ':') || !std::getline(stream, node_count, ':')
+                || !std::getline(stream, agent_count, ':') || !std::getline(stream, frames)) {
+                std::cerr << "scenario should be name:nodes:agents:frames" << std::endl;
+                return 2;
+            }
+            scenario.node_count = std::stoul(node_count);
+            scenario.agent_count = std::stoul(agent_count);
+            scenario.frames = std::stoul(frames);
+            if (scenario.node_count == 0 || scenario.agent_count == 0 || scenario.frames == 0) {
+                std::cerr << "scenario sizes must be positive" << std::endl;
+                return 2;
+            }
+            scenarios.push_back(scenario);
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--budget-us N] [--seed N] [--baseline FILE | --no-baseline]"
+                      << " [--scenario name:nodes:agents:frames]..." << std::endl;
+            return 2;
+        }
+    }
+
+    // 默认场景覆盖单棵树从10到1M个节点、群体从1到100k个智能体，更大的群体通过--scenario指定
+    if (scenarios.empty()) {
+        scenarios = {
+            {"tree_10", 10, 1, 2000},
+            {"tree_1k", 1000, 1, 2000},
+            {"tree_100k", 100000, 1, 100},
+            {"tree_1m", 1000000, 1, 10},
+            {"agents_1k", 10, 1000, 500},
+            {"agents_100k", 10, 100000, 20},
+        };
+    }
+
+    std::printf("%-14s %9s %9s %7s %9s %12s %9s %9s %9s %11s %11s %12s %12s %12s\n", "scenario", "nodes", "agents",
+                "frames", "samples", "ticks/s", "p50_ms", "p99_ms", "max_ms", "frame_p50", "frame_max", "peak_rss_kb",
+                "bytes/agent", "allocs/tick");
+    std::vector<Result> results;
+    unsigned int failures = 0;
+    for (auto &scenario : scenarios)
+    {
+        std::fflush(stdout);
+        Result result = RunIsolated(scenario, frame_budget, seed);
+        results.push_back(result);
+        if (!result.valid) {
+            std::printf("%-14s %9u %9u %7u %12s\n", scenario.name.c_str(), scenario.node_count, scenario.agent_count,
+                        scenario.frames, "FAILED");
+            failures++;
+            continue;
+        }
+        std::printf("%-14s %9u %9u %7u %9lu %12.0f %9.4f %9.4f %9.4f %11.3f %11.3f %12ld %12.0f %12.3f\n",
+                    scenario.name.c_str(), scenario.node_count, scenario.agent_count, scenario.frames, result.samples,
+                    result.ticks_per_sec, result.p50_ms, result.p99_ms, result.max_ms, result.frame_p50_ms,
+                    result.frame_max_ms, result.peak_rss_kb, result.bytes_per_agent, result.allocations_per_tick);
+    }
+
+    if (!baseline.empty()) {
+        failures += CheckBaseline(baseline, scenarios, results);
+    }
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,14 +1,39 @@
 #include<behavior_node.h>
 #include<behavior_tree.h>
+#include<tree_optimizer.h>
 #include<blackboard.h>
 #include<changePositionAction.h>
 #include<miningAction.h>
 #include<restAction.h>
 #include<heatWaterAction.h>
+#include<cctype>
+#include<cerrno>
+#include<cstdlib>
+#include<limits>
 
 using namespace std;
 
-int main()
+int Usage(const char *program)
+{
+    std::cerr << "usage: " << program << " [--shm <name> [slot]] [--stream <socket_path>]" << std::endl;
+    return 1;
+}
+
+// 整个字符串都是十进制数字且不超出unsigned int时返回true
+bool ParseUnsigned(const char *text, unsigned int &value)
+{
+    char *end = nullptr;
+    errno = 0;
+    unsigned long result = std::strtoul(text, &end, 10);
+    if (!std::isdigit((unsigned char)text[0]) || *end != '\0' || errno == ERANGE
+        || result > std::numeric_limits<unsigned int>::max()) {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
+int main(int argc, char **argv)
 {
     auto blackboard_ptr_ = std::make_shared<BlackBoard>();
     
@@ -50,8 +75,49 @@ int main()
     home_parallel->AddChildren(heat_water_action);
     home_parallel->AddChildren(rest_action);
 
+    // 首次遍历前校验并优化树结构，两个回家的动作配置相同，会被合并为一个节点
+    TreeOptimizer optimizer;
+    OptimizeReport report;
+    BehaviorNode::Ptr root_node = optimizer.Optimize(position_selector, report);
+    report.Info();
+    if (root_node == nullptr) {
+        return 1;
+    }
 
-    BehaviorTree root_(position_selector, 500, blackboard_ptr_);
+    BehaviorTree root_(root_node, 500, blackboard_ptr_);
+    for (int index = 1; index < argc; index++)
+    {
+        std::string option = argv[index];
+        // --shm <name> [slot]：与外部进程通过共享内存段交换黑板数据，见tools/shm_producer.cpp
+        if (option == "--shm" && index + 1 < argc)
+        {
+            std::string name = argv[++index];
+            unsigned int slot = 0;
+            if (index + 1 < argc && argv[index + 1][0] != '-' && !ParseUnsigned(argv[++index], slot)) {
+                std::cerr << "invalid shm slot: " << argv[index] << std::endl;
+                return Usage(argv[0]);
+            }
+            auto shm_binding = std::make_shared<ShmBinding>(ShmSegment::Open(name), slot);
+            if (!shm_binding->IsValid()) {
+                std::cerr << "invalid shm slot" << std::endl;
+                return 1;
+            }
+            root_.SetShmBinding(shm_binding);
+        }
+        // --stream <socket_path>：把节点状态变化发布给tools/tree_debugger.cpp
+        else if (option == "--stream" && index + 1 < argc)
+        {
+            auto state_publisher = std::make_shared<StatePublisher>(argv[++index]);
+            if (!state_publisher->IsOpen()) {
+                return 1;
+            }
+            root_.SetStatePublisher(state_publisher);
+        }
+        else
+        {
+            return Usage(argv[0]);
+        }
+    }
     root_.Run();
     
     
@@ -0,0 +1,64 @@
+#include<shm_segment.h>
+#include<chrono>
+#include<thread>
+#include<vector>
+
+/**
+ * 共享内存段的外部进程示例，代替仿真/感知进程：
+ * 创建共享内存段，周期性读取各槽位的决策结果，并在运行一段时间后写入一次“精力耗尽”的感知输入。
+ *
+ * shm_producer <name> [slot_count] [seconds]
+ * 另开终端运行 behavior_tree --shm <name> [slot] 即可观察决策进程对输入的响应
+ */
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <name> [slot_count] [seconds]" << std::endl;
+        return 1;
+    }
+    std::string name = argv[1];
+    unsigned int slot_count = argc >= 3 ? std::stoi(argv[2]) : 1;
+    std::chrono::seconds duration(argc >= 4 ? std::stoi(argv[3]) : 10);
+
+    auto segment = ShmSegment::Create(name, slot_count);
+    if (segment == nullptr) {
+        return 1;
+    }
+    std::cout << "created " << name << " with " << slot_count << " slots" << std::endl;
+
+    std::vector<uint32_t> output_sequences(slot_count, 0);
+    std::vector<bool> input_written(slot_count, false);
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start_time < duration)
+    {
+        for (unsigned int index = 0; index < slot_count; index++)
+        {
+            ShmSlot *slot_ptr = segment->GetSlot(index);
+            int32_t values[ShmBlock::FIELD_COUNT];
+            uint32_t sequence;
+            if (!slot_ptr->output.Read(values, sequence) || sequence == 0 || sequence == output_sequences.at(index)) {
+                continue;
+            }
+            output_sequences.at(index) = sequence;
+            std::cout << "slot " << index
+                      << " frame " << values[(int)ShmField::FRAME]
+                      << " position " << values[(int)ShmField::POSITION]
+                      << " destination " << values[(int)ShmField::DESTINATION]
+                      << " energy " << values[(int)ShmField::ENERGY] << std::endl;
+
+            // 决策进程运行几帧后，模拟感知到智能体精力耗尽
+            if (!input_written.at(index) && values[(int)ShmField::FRAME] >= 3)
+            {
+                int32_t inputs[ShmBlock::FIELD_COUNT] = {0};
+                inputs[(int)ShmField::POSITION] = values[(int)ShmField::POSITION];
+                inputs[(int)ShmField::ENERGY] = 10;
+                slot_ptr->input.Write(inputs);
+                input_written.at(index) = true;
+                std::cout << "slot " << index << " input energy 10" << std::endl;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return 0;
+}
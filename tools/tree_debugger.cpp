@@ -0,0 +1,199 @@
+#include<state_stream.h>
+#include<chrono>
+#include<map>
+
+/**
+ * 状态变化流的参考接收端：接收StatePublisher发布的节点表与状态变化，重建并打印各棵树的当前状态。
+ *
+ * tree_debugger <socket_path> [seconds]
+ * 先启动接收端，再运行 behavior_tree --stream <socket_path>；seconds为0或省略时一直运行
+ */
+
+static const char *behavior_types[] = {FOREACH_BEHAVIORTYPE(TO_STRING)};
+static const char *behavior_states[] = {FOREACH_BEHAVIORSTATE(TO_STRING)};
+
+struct NodeView
+{
+    uint32_t parent_id;
+    uint8_t type;
+    uint8_t state;
+    bool aborted;
+    std::string name;
+};
+
+// 一棵树的视图，由最近一次完整的节点表加上其后的状态变化构成
+struct TreeView
+{
+    uint64_t epoch = 0;
+    uint64_t node_count = 0;
+    uint64_t sequence = 0;
+    bool received = false;
+    unsigned long lost_messages = 0;
+    std::map<uint32_t, NodeView> nodes;
+};
+
+void PrintNode(const TreeView &tree_view, const std::multimap<uint32_t, uint32_t> &children,
+               uint32_t node_id, unsigned int depth)
+{
+    const NodeView &node = tree_view.nodes.at(node_id);
+    std::cout << std::string(depth * 2, ' ') << node.name << " ["
+              << (node.type < sizeof(behavior_types) / sizeof(behavior_types[0]) ? behavior_types[node.type] : "?")
+              << "] " << (node.state < 4 ? behavior_states[node.state] : "?")
+              << (node.aborted ? " (aborted)" : "") << std::endl;
+    auto range = children.equal_range(node_id + 1);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        PrintNode(tree_view, children, iter->second, depth + 1);
+    }
+}
+
+void PrintTree(uint64_t tree_id, const TreeView &tree_view, uint64_t frame)
+{
+    std::multimap<uint32_t, uint32_t> children;
+    for (auto &node : tree_view.nodes) {
+        children.insert(std::make_pair(node.second.parent_id, node.first));
+    }
+    std::cout << "=== tree " << tree_id << " frame " << frame << " epoch " << tree_view.epoch
+              << " lost " << tree_view.lost_messages << std::endl;
+    auto range = children.equal_range(0);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        PrintNode(tree_view, children, iter->second, 0);
+    }
+    std::cout << std::endl;
+}
+
+// 消息不完整时返回false
+bool HandleMessage(const uint8_t *data, const uint8_t *end, std::map<uint64_t, TreeView> &tree_views)
+{
+    if (data == end) {
+        return false;
+    }
+    uint8_t type = *data++;
+    uint64_t tree_id, epoch, sequence;
+    if (!StateStream::GetVarint(data, end, tree_id) || !StateStream::GetVarint(data, end, epoch)
+        || !StateStream::GetVarint(data, end, sequence)) {
+        return false;
+    }
+    TreeView &tree_view = tree_views[tree_id];
+    // sequence变小说明发布端重启过
+    if (tree_view.received && sequence > tree_view.sequence + 1) {
+        tree_view.lost_messages += sequence - tree_view.sequence - 1;
+    }
+    tree_view.received = true;
+    tree_view.sequence = sequence;
+
+    switch ((StateMessageType)type)
+    {
+        case StateMessageType::SCHEMA_BEGIN:
+        {
+            if (!StateStream::GetVarint(data, end, tree_view.node_count)) {
+                return false;
+            }
+            tree_view.epoch = epoch;
+            tree_view.nodes.clear();
+            return true;
+        }
+        case StateMessageType::SCHEMA_NODES:
+        {
+            uint64_t count;
+            if (epoch != tree_view.epoch || !StateStream::GetVarint(data, end, count)) {
+                return false;
+            }
+            for (uint64_t index = 0; index < count; index++)
+            {
+                uint64_t node_id, parent_id, name_length;
+                if (!StateStream::GetVarint(data, end, node_id) || !StateStream::GetVarint(data, end, parent_id)
+                    || end - data < 2) {
+                    return false;
+                }
+                NodeView &node = tree_view.nodes[node_id];
+                node.parent_id = parent_id;
+                node.type = *data++;
+                node.state = *data++;
+                node.aborted = false;
+                if (!StateStream::GetVarint(data, end, name_length) || (uint64_t)(end - data) < name_length) {
+                    return false;
+                }
+                node.name.assign((const char*)data, name_length);
+                data += name_length;
+            }
+            // 节点表收齐后打印
+            if (tree_view.nodes.size() == tree_view.node_count) {
+                PrintTree(tree_id, tree_view, 0);
+            }
+            return true;
+        }
+        case StateMessageType::FRAME:
+        {
+            uint64_t frame, count;
+            // 节点表之前的状态变化无法对应到节点上
+            if (epoch != tree_view.epoch || !StateStream::GetVarint(data, end, frame)
+                || !StateStream::GetVarint(data, end, count)) {
+                return false;
+            }
+            for (uint64_t index = 0; index < count; index++)
+            {
+                uint64_t event;
+                if (!StateStream::GetVarint(data, end, event)) {
+                    return false;
+                }
+                auto iter = tree_view.nodes.find(event >> 3);
+                if (iter != tree_view.nodes.end()) {
+                    iter->second.state = event & 3;
+                    iter->second.aborted = (event & 4) != 0;
+                }
+            }
+            PrintTree(tree_id, tree_view, frame);
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <socket_path> [seconds]" << std::endl;
+        return 1;
+    }
+    std::string socket_path = argv[1];
+    std::chrono::seconds duration(argc >= 3 ? std::stoi(argv[2]) : 0);
+
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "socket path too long" << std::endl;
+        return 1;
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    unlink(socket_path.c_str());
+    if (fd < 0 || bind(fd, (const struct sockaddr*)&address, sizeof(address)) != 0) {
+        std::cerr << "bind " << socket_path << " failed: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    // 定时醒来检查是否到时
+    struct timeval timeout = {0, 200 * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::map<uint64_t, TreeView> tree_views;
+    std::vector<uint8_t> buffer(StateStream::MAX_MESSAGE_SIZE);
+    unsigned long invalid_messages = 0;
+    std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+    while (duration.count() == 0 || std::chrono::steady_clock::now() - start_time < duration)
+    {
+        ssize_t size = recv(fd, buffer.data(), buffer.size(), 0);
+        if (size <= 0) {
+            continue;
+        }
+        if (!HandleMessage(buffer.data(), buffer.data() + size, tree_views)) {
+            invalid_messages++;
+        }
+    }
+    close(fd);
+    unlink(socket_path.c_str());
+    std::cout << "invalid or stale messages: " << invalid_messages << std::endl;
+    return 0;
+}